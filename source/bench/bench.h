@@ -0,0 +1,155 @@
+#ifndef INCLUDED_BENCH
+#define INCLUDED_BENCH
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace bench
+{
+	struct timing
+	{
+		double min;     // milliseconds
+		double median;  // milliseconds
+	};
+
+	constexpr int MAX_RUNS = 64;
+
+	// runs f the given number of times (at most MAX_RUNS) after one warm-up run
+	template <typename F>
+	timing measure(int runs, F&& f) noexcept
+	{
+		double times[MAX_RUNS];
+		runs = std::clamp(runs, 1, MAX_RUNS);
+
+		f();
+
+		for (int i = 0; i < runs; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			f();
+			auto stop = std::chrono::steady_clock::now();
+			times[i] = std::chrono::duration<double, std::milli>(stop - start).count();
+		}
+
+		std::sort(times, times + runs);
+		return { times[0], times[runs / 2] };
+	}
+
+	// asks the system to forget the cached contents of the file at path, so that the next read has to go to the disk;
+	// returns false where that is not supported
+	inline bool dropFromCache(const char* path) noexcept
+	{
+#if defined(POSIX_FADV_DONTNEED)
+		int fd = open(path, O_RDONLY);
+
+		if (fd < 0)
+			return false;
+
+		bool dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+		close(fd);
+		return dropped;
+#else
+		return false;
+#endif
+	}
+
+	inline void report(const char* label, timing t, std::size_t size) noexcept
+	{
+		std::printf("%-32s min %9.3f ms  median %9.3f ms  %8.1f MiB/s\n", label, t.min, t.median, size / (1024.0 * 1024.0) / (t.min / 1000.0));
+	}
+
+	// writes an OBJ file describing a grid of n x n quads with positions, texture coordinates and normals
+	// to buffer and returns its size; pass buffer = nullptr to only compute the size. Scattered quads are written in an
+	// order that jumps across the grid, so that faces that follow each other share no vertices
+	inline std::size_t generateGrid(char* buffer, int n, bool scattered = false) noexcept
+	{
+		std::size_t size = 0;
+
+		auto write = [&](auto... args)
+		{
+			char line[128];
+			int len = std::snprintf(line, sizeof(line), args...);
+			if (buffer)
+				std::copy(line, line + len, buffer + size);
+			size += len;
+		};
+
+		for (int y = 0; y <= n; ++y)
+			for (int x = 0; x <= n; ++x)
+				write("v %.6f %.6f %.6f\n", x / static_cast<float>(n), y / static_cast<float>(n), 0.25f * ((x * 7 + y * 13) % 17) / 17.0f);
+
+		for (int y = 0; y <= n; ++y)
+			for (int x = 0; x <= n; ++x)
+				write("vt %.6f %.6f\n", x / static_cast<float>(n), y / static_cast<float>(n));
+
+		write("vn 0 0 1\n");
+
+		// stepping by a prime that does not divide n visits every quad once
+		constexpr long long STRIDE = 1000003;
+		long long num_quads = static_cast<long long>(n) * n;
+
+		for (long long q = 0; q < num_quads; ++q)
+		{
+			auto quad = scattered ? q * STRIDE % num_quads : q;
+			int i = static_cast<int>(quad / n * (n + 1) + quad % n) + 1;
+			write("f %d/%d/1 %d/%d/1 %d/%d/1 %d/%d/1\n", i, i, i + 1, i + 1, i + n + 2, i + n + 2, i + n + 1, i + n + 1);
+		}
+
+		return size;
+	}
+
+	// writes an OBJ file with n positions, texture coordinates and normals, and triangles made of num_corners face
+	// vertices v/t/n that pick(v, t, n) accepts, tried in order of v, then t, then n, which lets a benchmark craft faces
+	// that collide in a hash table; returns its size, pass buffer = nullptr to only compute the size
+	template <typename Pick>
+	std::size_t generateFaces(char* buffer, int n, int num_corners, Pick&& pick) noexcept
+	{
+		std::size_t size = 0;
+
+		auto write = [&](auto... args)
+		{
+			char line[128];
+			int len = std::snprintf(line, sizeof(line), args...);
+			if (buffer)
+				std::copy(line, line + len, buffer + size);
+			size += len;
+		};
+
+		for (int i = 0; i < n; ++i)
+			write("v %d %d %d\n", i % 10, i / 10 % 10, i / 100);
+
+		for (int i = 0; i < n; ++i)
+			write("vt %d %d\n", i % 10, i / 10);
+
+		for (int i = 0; i < n; ++i)
+			write("vn %d %d 1\n", i % 10, i / 10);
+
+		long long c = 0;
+		for (int corner = 0; corner < num_corners; ++c)
+		{
+			int v = static_cast<int>(c % n) + 1;
+			int t = static_cast<int>(c / n % n) + 1;
+			int vn = static_cast<int>(c / n / n % n) + 1;
+
+			if (!pick(v, t, vn))
+				continue;
+
+			write(corner % 3 == 0 ? "f %d/%d/%d" : corner % 3 == 1 ? " %d/%d/%d" : " %d/%d/%d\n", v, t, vn);
+			++corner;
+		}
+
+		return size;
+	}
+}
+
+#endif  // INCLUDED_BENCH
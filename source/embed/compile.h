@@ -0,0 +1,433 @@
+#ifndef INCLUDED_EMBED_COMPILE
+#define INCLUDED_EMBED_COMPILE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cfloat>
+#include <array>
+#include <string_view>
+
+#include <math/vector.h>
+
+#include "mesh.h"
+
+
+namespace embed
+{
+	// a mesh whose arrays are exactly as large as the data in them, as returned by compileOBJ
+	template <std::size_t V, std::size_t T>
+	struct StaticMesh
+	{
+		std::array<float3, V> positions = {};
+		std::array<float3, V> normals = {};
+		std::array<float2, V> texcoords = {};
+		std::array<std::array<int, 3>, T> triangles = {};
+
+		constexpr operator Mesh() const noexcept
+		{
+			return { positions.data(), normals.data(), texcoords.data(), V, triangles.data(), T };
+		}
+	};
+
+	namespace detail
+	{
+		// not constexpr, so reaching it during constant evaluation fails the compilation of compileOBJ
+		// with line and msg in the diagnostic
+		inline void objError(int line, const char* msg) noexcept
+		{
+		}
+
+		constexpr std::string_view nextToken(std::string_view& line) noexcept
+		{
+			auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+
+			std::size_t begin = 0;
+			while (begin < line.size() && isSpace(line[begin]))
+				++begin;
+
+			std::size_t end = begin;
+			while (end < line.size() && !isSpace(line[end]))
+				++end;
+
+			auto token = line.substr(begin, end - begin);
+			line.remove_prefix(end);
+			return token;
+		}
+
+		constexpr bool isDigit(char c) noexcept
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		constexpr bool toInteger(std::string_view token, int& value) noexcept
+		{
+			std::size_t i = 0;
+
+			bool negative = i < token.size() && token[i] == '-';
+			if (negative)
+				++i;
+
+			if (i == token.size())
+				return false;
+
+			std::int64_t n = 0;
+
+			for (; i < token.size(); ++i)
+			{
+				if (!isDigit(token[i]))
+					return false;
+
+				n = n * 10 + (token[i] - '0');
+
+				if (n > 0x7FFFFFFF)
+					return false;
+			}
+
+			value = static_cast<int>(negative ? -n : n);
+			return true;
+		}
+
+		// converts the same forms as parse::parseFloat with the same, correctly rounded results, as long as the conversion
+		// can be done exactly in float or double arithmetic; everything else is left to objembed
+		constexpr bool toFloat(std::string_view token, float& value) noexcept
+		{
+			std::size_t i = 0;
+
+			bool negative = i < token.size() && token[i] == '-';
+			if (negative)
+				++i;
+
+			std::uint64_t mantissa = 0;
+			int num_digits = 0;
+			int num_significant_digits = 0;
+			int exponent = 0;
+
+			for (bool fraction = false; i < token.size(); ++i)
+			{
+				if (token[i] == '.' && !fraction)
+				{
+					fraction = true;
+					continue;
+				}
+
+				if (!isDigit(token[i]))
+					break;
+
+				mantissa = mantissa * 10 + static_cast<unsigned>(token[i] - '0');
+				num_significant_digits += mantissa != 0;
+				++num_digits;
+				exponent -= fraction;
+			}
+
+			if (num_digits == 0 || num_significant_digits > 19)
+				return false;
+
+			if (i < token.size() && (token[i] == 'e' || token[i] == 'E'))
+			{
+				int e = 0;
+				if (!toInteger(token.substr(i + 1), e) || e < -1000 || e > 1000)
+					return false;
+
+				exponent += e;
+				i = token.size();
+			}
+
+			if (i != token.size())
+				return false;
+
+			if (mantissa == 0)
+			{
+				value = negative ? -0.0f : 0.0f;
+				return true;
+			}
+
+			// Clinger's fast path, as in parse::parseFloat
+			constexpr float float_powers_of_ten[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+			if (exponent >= -10 && exponent <= 10 && mantissa <= (std::uint64_t(1) << 24))
+			{
+				float f = static_cast<float>(mantissa);
+				f = exponent < 0 ? f / float_powers_of_ten[-exponent] : f * float_powers_of_ten[exponent];
+				value = negative ? -f : f;
+				return true;
+			}
+
+			// the same in double is correctly rounded too, which carries over to float unless it lands exactly between two floats
+			constexpr double double_powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+			if (exponent < -22 || exponent > 22 || mantissa > (std::uint64_t(1) << 53))
+				return false;
+
+			double d = static_cast<double>(mantissa);
+			d = exponent < 0 ? d / double_powers_of_ten[-exponent] : d * double_powers_of_ten[exponent];
+
+			if (d < FLT_MIN || d > FLT_MAX)
+				return false;
+
+			double binade = 1.0;
+			while (binade * 2.0 <= d)
+				binade *= 2.0;
+			while (binade > d)
+				binade *= 0.5;
+
+			float f = static_cast<float>(d);
+			double half_ulp = binade / (1 << 24);
+
+			if (d - f == half_ulp || f - d == half_ulp)
+				return false;
+
+			value = negative ? -f : f;
+			return true;
+		}
+
+		// v, v/t, v//n or v/t/n, with 0 standing in for indices that are left out
+		constexpr bool toFaceVertex(std::string_view token, std::array<int, 3>& vertex) noexcept
+		{
+			vertex = { 0, 0, 0 };
+
+			auto slash = token.find('/');
+			if (!toInteger(token.substr(0, slash), vertex[0]))
+				return false;
+
+			if (slash == std::string_view::npos)
+				return true;
+
+			token.remove_prefix(slash + 1);
+			slash = token.find('/');
+
+			if (auto t = token.substr(0, slash); !t.empty() && !toInteger(t, vertex[2]))
+				return false;
+
+			if (slash == std::string_view::npos)
+				return true;
+
+			auto n = token.substr(slash + 1);
+			return n.empty() || toInteger(n, vertex[1]);
+		}
+
+		constexpr int MAX_FACE_VERTICES = 7;
+
+		// runs the statements of obj past sink, with the same rules and messages as OBJ::Reader and OBJ::OBJConsumer
+		template <typename Sink>
+		constexpr bool parseOBJ(std::string_view obj, Sink& sink) noexcept
+		{
+			for (int line = 1; !obj.empty(); ++line)
+			{
+				auto line_end = obj.find('\n');
+				auto rest = obj.substr(0, line_end);
+				obj.remove_prefix(line_end == std::string_view::npos ? obj.size() : line_end + 1);
+
+				auto cmd = nextToken(rest);
+
+				std::string_view args[MAX_FACE_VERTICES + 1] = {};
+				int num_args = 0;
+
+				for (auto arg = nextToken(rest); !arg.empty(); arg = nextToken(rest))
+				{
+					if (num_args > MAX_FACE_VERTICES)
+						return objError(line, "expected newline"), false;
+					args[num_args++] = arg;
+				}
+
+				if (cmd.empty() || cmd[0] == '#' || cmd == "o" || cmd == "g" || cmd == "s" || cmd == "mtllib" || cmd == "usemtl")
+					continue;
+
+				float f[3] = {};
+
+				if (cmd == "v" || cmd == "vn" || cmd == "vt")
+				{
+					int expected_args = cmd == "vt" ? 2 : 3;
+
+					if (cmd == "v" && num_args == 4)
+						return objError(line, "weighted vertex coordinates are not supported"), false;
+					if (cmd == "vt" && num_args == 1)
+						return objError(line, "1D texture coordinates are not supported"), false;
+					if (cmd == "vt" && num_args == 3)
+						return objError(line, "3D texture coordinates are not supported"), false;
+					if (num_args < expected_args)
+						return objError(line, "expected floating point number"), false;
+					if (num_args > expected_args)
+						return objError(line, "expected newline"), false;
+
+					for (int i = 0; i < num_args; ++i)
+						if (!toFloat(args[i], f[i]))
+							return objError(line, "floating point number cannot be converted at compile time, use objembed"), false;
+
+					if (cmd == "v")
+						sink.vertex({ f[0], f[1], f[2] });
+					else if (cmd == "vn")
+						sink.normal({ f[0], f[1], f[2] });
+					else
+						sink.texcoord({ f[0], 1.0f - f[1] });
+				}
+				else if (cmd == "f")
+				{
+					if (num_args > MAX_FACE_VERTICES)
+						return objError(line, "this face has too many vertices"), false;
+					if (num_args < 3)
+						return objError(line, "face must have at least three vertices"), false;
+
+					std::array<int, 3> vertices[MAX_FACE_VERTICES] = {};
+
+					for (int i = 0; i < num_args; ++i)
+						if (!toFaceVertex(args[i], vertices[i]))
+							return objError(line, "expected integer"), false;
+
+					if (!sink.face(vertices, num_args))
+						return objError(line, "face vertex index out of range"), false;
+				}
+				else
+					return objError(line, "unknown command"), false;
+			}
+
+			return true;
+		}
+
+		struct obj_counts
+		{
+			std::size_t vertices = 0;
+			std::size_t normals = 0;
+			std::size_t texcoords = 0;
+			std::size_t face_vertices = 0;
+			std::size_t triangles = 0;
+
+			constexpr void vertex(float3) noexcept
+			{
+				++vertices;
+			}
+
+			constexpr void normal(float3) noexcept
+			{
+				++normals;
+			}
+
+			constexpr void texcoord(float2) noexcept
+			{
+				++texcoords;
+			}
+
+			constexpr bool face(const std::array<int, 3>*, int count) noexcept
+			{
+				face_vertices += count;
+				triangles += count - 2;
+				return true;
+			}
+		};
+
+		constexpr obj_counts countOBJ(std::string_view obj) noexcept
+		{
+			obj_counts counts;
+			parseOBJ(obj, counts);
+			return counts;
+		}
+
+		// collects the output the way OBJ::OBJConsumer does, sized for the case that no face vertex is shared
+		template <std::size_t NV, std::size_t NN, std::size_t NT, std::size_t NF, std::size_t NTRI>
+		struct obj_builder
+		{
+			std::array<float3, NV> v = {};
+			std::array<float3, NN + 1> vn = {};
+			std::array<float2, NT + 1> vt = {};
+			int num_v = 0;
+			int num_vn = 1;
+			int num_vt = 1;
+
+			std::array<std::array<int, 3>, NF> keys = {};
+			StaticMesh<NF, NTRI> mesh;
+			std::size_t num_vertices = 0;
+			std::size_t num_triangles = 0;
+
+			constexpr void vertex(float3 p) noexcept
+			{
+				v[num_v++] = p;
+			}
+
+			constexpr void normal(float3 n) noexcept
+			{
+				vn[num_vn++] = n;
+			}
+
+			constexpr void texcoord(float2 t) noexcept
+			{
+				vt[num_vt++] = t;
+			}
+
+			constexpr bool insertFaceVertex(const std::array<int, 3>& vertex, int& fv) noexcept
+			{
+				std::array<int, 3> key = { vertex[0] < 0 ? num_v + vertex[0] : vertex[0] - 1, vertex[1] < 0 ? num_vn + vertex[1] : vertex[1], vertex[2] < 0 ? num_vt + vertex[2] : vertex[2] };
+
+				if (key[0] < 0 || key[0] >= num_v || key[1] < 0 || key[1] >= num_vn || key[2] < 0 || key[2] >= num_vt)
+					return false;
+
+				for (std::size_t i = 0; i < num_vertices; ++i)
+					if (keys[i][0] == key[0] && keys[i][1] == key[1] && keys[i][2] == key[2])
+						return fv = static_cast<int>(i), true;
+
+				keys[num_vertices] = key;
+				mesh.positions[num_vertices] = v[key[0]];
+				mesh.normals[num_vertices] = vn[key[1]];
+				mesh.texcoords[num_vertices] = vt[key[2]];
+				fv = static_cast<int>(num_vertices++);
+				return true;
+			}
+
+			constexpr bool face(const std::array<int, 3>* vertices, int count) noexcept
+			{
+				int face_vertices[MAX_FACE_VERTICES] = {};
+
+				for (int i = 0; i < count; ++i)
+					if (!insertFaceVertex(vertices[i], face_vertices[i]))
+						return false;
+
+				for (int i = 2; i < count; ++i)
+					mesh.triangles[num_triangles++] = { face_vertices[0], face_vertices[i - 1], face_vertices[i] };
+
+				return true;
+			}
+		};
+
+		template <std::size_t NV, std::size_t NN, std::size_t NT, std::size_t NF, std::size_t NTRI>
+		constexpr obj_builder<NV, NN, NT, NF, NTRI> buildOBJ(std::string_view obj) noexcept
+		{
+			obj_builder<NV, NN, NT, NF, NTRI> builder;
+			parseOBJ(obj, builder);
+			return builder;
+		}
+
+		template <std::size_t V, std::size_t T, std::size_t MAX_V, std::size_t MAX_T>
+		constexpr StaticMesh<V, T> shrink(const StaticMesh<MAX_V, MAX_T>& mesh) noexcept
+		{
+			StaticMesh<V, T> out;
+
+			for (std::size_t i = 0; i < V; ++i)
+			{
+				out.positions[i] = mesh.positions[i];
+				out.normals[i] = mesh.normals[i];
+				out.texcoords[i] = mesh.texcoords[i];
+			}
+
+			for (std::size_t i = 0; i < T; ++i)
+				out.triangles[i] = mesh.triangles[i];
+
+			return out;
+		}
+	}
+
+	// parses a small OBJ file at compile time into the same triangles that OBJ::readTriangles would return;
+	// source is a lambda that returns the file contents, which lets them be used as a constant expression:
+	//
+	//   constexpr auto quad = embed::compileOBJ([] { return "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n"sv; });
+	//
+	// an OBJ file that has errors, or numbers that cannot be converted exactly in a constant expression, fails to compile
+	template <typename Source>
+	constexpr auto compileOBJ(Source source) noexcept
+	{
+		constexpr auto counts = detail::countOBJ(source());
+		constexpr auto builder = detail::buildOBJ<counts.vertices, counts.normals, counts.texcoords, counts.face_vertices, counts.triangles>(source());
+		return detail::shrink<builder.num_vertices, builder.num_triangles>(builder.mesh);
+	}
+}
+
+#endif  // INCLUDED_EMBED_COMPILE
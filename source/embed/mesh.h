@@ -0,0 +1,28 @@
+#ifndef INCLUDED_EMBED_MESH
+#define INCLUDED_EMBED_MESH
+
+#pragma once
+
+#include <cstddef>
+#include <array>
+
+#include <math/vector.h>
+
+
+namespace embed
+{
+	// the triangles of an OBJ file that was parsed when the program was built, in the layout of OBJ::Triangles;
+	// the arrays are constant data, produced by objembed (see add_embedded_obj) or by compileOBJ (see compile.h)
+	struct Mesh
+	{
+		const float3* positions;
+		const float3* normals;
+		const float2* texcoords;
+		std::size_t num_vertices;
+
+		const std::array<int, 3>* triangles;
+		std::size_t num_triangles;
+	};
+}
+
+#endif  // INCLUDED_EMBED_MESH
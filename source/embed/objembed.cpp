@@ -0,0 +1,170 @@
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cmath>
+
+#include <except/obj.h>
+
+using namespace std::literals;
+
+
+namespace
+{
+	struct usage_error : std::runtime_error
+	{
+		using std::runtime_error::runtime_error;
+	};
+
+	std::ostream& printUsage(std::ostream& out)
+	{
+		return out << "objembed <input.obj> <output.h> <name>";
+	}
+
+	// only diagnostics are of interest while building
+	struct DiagnosticsStreamCallback : OBJ::StreamCallback
+	{
+		void progress(float progress) override
+		{
+		}
+
+		void warning(std::string_view file, std::int64_t line, std::string_view msg) override
+		{
+			std::cerr << file << '(' << line << "): warning: " << msg << '\n';
+		}
+
+		void error(std::string_view file, std::int64_t line, std::string_view msg) override
+		{
+			std::cerr << file << '(' << line << "): error: " << msg << '\n';
+		}
+
+		void finish() override
+		{
+		}
+	};
+
+	bool isIdentifier(std::string_view name)
+	{
+		auto isAlpha = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; };
+		auto isAlnum = [&](char c) { return isAlpha(c) || (c >= '0' && c <= '9'); };
+
+		if (name.empty() || !isAlpha(name[0]))
+			return false;
+
+		for (char c : name)
+			if (!isAlnum(c))
+				return false;
+
+		return true;
+	}
+
+	// the shortest literal that converts back to exactly f
+	std::ostream& writeFloat(std::ostream& out, float f)
+	{
+		if (std::isnan(f))
+			return out << "std::numeric_limits<float>::quiet_NaN()";
+
+		if (std::isinf(f))
+			return out << (f < 0.0f ? "-" : "") << "std::numeric_limits<float>::infinity()";
+
+		char buffer[32];
+		auto [end, err] = std::to_chars(buffer, buffer + sizeof(buffer), f);
+		std::string_view digits(buffer, end - buffer);
+
+		out << digits;
+
+		if (digits.find_first_of(".e"sv) == std::string_view::npos)
+			out << ".0";
+
+		return out << 'f';
+	}
+
+	template <typename V, typename Write>
+	void writeArray(std::ostream& out, const char* type, const char* name, const std::vector<V>& elements, Write&& write)
+	{
+		if (elements.empty())
+			return;
+
+		out << "\tinline constexpr " << type << ' ' << name << "[] = {\n";
+
+		for (const auto& e : elements)
+			write(out << "\t\t{ ", e) << " },\n";
+
+		out << "\t};\n\n";
+	}
+
+	void writeHeader(std::ostream& out, const OBJ::Triangles& obj, std::string_view source, std::string_view name)
+	{
+		out << "// generated from " << source << " by objembed, do not edit\n\n"
+		       "#pragma once\n\n"
+		       "#include <limits>\n\n"
+		       "#include <embed/mesh.h>\n\n\n"
+		       "namespace embedded::" << name << "\n{\n";
+
+		auto write3 = [](std::ostream& out, const float3& v) -> std::ostream& { return writeFloat(writeFloat(writeFloat(out, v.x) << ", ", v.y) << ", ", v.z); };
+		auto write2 = [](std::ostream& out, const float2& v) -> std::ostream& { return writeFloat(writeFloat(out, v.x) << ", ", v.y); };
+		auto writeTriangle = [](std::ostream& out, const std::array<int, 3>& t) -> std::ostream& { return out << t[0] << ", " << t[1] << ", " << t[2]; };
+
+		writeArray(out, "float3", "positions", obj.positions, write3);
+		writeArray(out, "float3", "normals", obj.normals, write3);
+		writeArray(out, "float2", "texcoords", obj.texcoords, write2);
+		writeArray(out, "std::array<int, 3>", "triangles", obj.triangles, writeTriangle);
+
+		auto array = [](const auto& elements, const char* name) { return elements.empty() ? "nullptr"s : std::string(name); };
+
+		out << "\tinline constexpr embed::Mesh mesh = {\n"
+		       "\t\t" << array(obj.positions, "positions") << ", " << array(obj.normals, "normals") << ", " << array(obj.texcoords, "texcoords") << ", " << size(obj.positions) << ",\n"
+		       "\t\t" << array(obj.triangles, "triangles") << ", " << size(obj.triangles) << "\n"
+		       "\t};\n"
+		       "}\n";
+	}
+}
+
+// compiles an OBJ file into a header with its triangles as constant data, see add_embedded_obj
+int main(int argc, const char* argv[])
+{
+	try
+	{
+		if (argc != 4)
+			throw usage_error("expected <input.obj> <output.h> <name>");
+
+		std::filesystem::path input = argv[1];
+		std::filesystem::path output = argv[2];
+		std::string_view name = argv[3];
+
+		if (!isIdentifier(name))
+			throw usage_error("<name> must be an identifier");
+
+		DiagnosticsStreamCallback callback;
+		auto obj = OBJ::readTriangles(input, callback);
+
+		// written in one go so that a failed run does not leave behind a header that looks up to date
+		std::ostringstream header;
+		writeHeader(header, obj, input.filename().u8string(), name);
+
+		std::ofstream file(output, std::ios::binary);
+		file << header.str();
+
+		if (!file)
+			throw std::runtime_error("failed to write header");
+	}
+	catch (const usage_error& e)
+	{
+		printUsage(std::cerr << "error: " << e.what() << '\n');
+		return -2;
+	}
+	catch (const OBJ::parse_error&)
+	{
+		return -1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,363 @@
+#include <memory>
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include <bench/bench.h>
+#include <parse/kernels.h>
+
+#include "hash_map.h"
+#include "obj_reader.h"
+#include "obj_consumer.h"
+#include "obj_triangles.h"
+#include "obj.h"
+
+
+namespace
+{
+	// does nothing, but has to be reached through the virtual interface
+	struct SilentStreamCallback : OBJ::StreamCallback
+	{
+		void progress(float progress) override
+		{
+		}
+
+		void warning(std::string_view file, std::int64_t line, std::string_view msg) override
+		{
+		}
+
+		void error(std::string_view file, std::int64_t line, std::string_view msg) override
+		{
+		}
+
+		void finish() override
+		{
+		}
+	};
+
+	// remembers how long it took until the first preview of a progressive load arrived
+	struct PreviewTimer : OBJ::PreviewStreamCallback
+	{
+		std::chrono::steady_clock::time_point start;
+		double first_preview;  // milliseconds
+
+		void progress(float progress) override
+		{
+		}
+
+		void warning(std::string_view file, std::int64_t line, std::string_view msg) override
+		{
+		}
+
+		void error(std::string_view file, std::int64_t line, std::string_view msg) override
+		{
+		}
+
+		void finish() override
+		{
+		}
+
+		void preview(const OBJ::Triangles& triangles, std::size_t face_stride) override
+		{
+			if (first_preview < 0.0)
+				first_preview = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+	};
+
+	// hands out the input one block at a time, like a pipe would
+	struct MemoryReadCallback : OBJ::ReadCallback
+	{
+		const char* ptr;
+		const char* end;
+
+		MemoryReadCallback(const std::string& data)
+			: ptr(data.data()), end(data.data() + data.size())
+		{
+		}
+
+		std::size_t read(char* buffer, std::size_t size) override
+		{
+			auto n = std::min(size, static_cast<std::size_t>(end - ptr));
+			std::memcpy(buffer, ptr, n);
+			ptr += n;
+			return n;
+		}
+	};
+
+	using VertexKey = OBJ::vertex_key<OBJ::Attributes::ALL>;
+
+	// records the face vertices of the input as the keys that the consumer looks them up by, so that the vertex map
+	// can be timed on its own
+	struct FaceVertexRecorder : OBJ::OBJConsumer
+	{
+		std::vector<VertexKey> keys;
+
+		template <typename Stream>
+		void consumeFaceVertex(Stream& stream, int vi, int ni, int ti)
+		{
+			keys.push_back(VertexKey::make(vi, ni, ti));
+		}
+
+		template <typename Stream>
+		void consumeFaceVertices(Stream& stream, const OBJ::face_vertex_t* vertices, int count)
+		{
+			for (int i = 0; i < count; ++i)
+				keys.push_back(VertexKey::make(vertices[i].v, vertices[i].n, vertices[i].t));
+		}
+
+		template <typename Stream>
+		void finishFace(Stream& stream)
+		{
+		}
+	};
+
+	std::vector<VertexKey> recordFaceVertices(const std::string& data)
+	{
+		OBJ::NullStreamCallback null;
+		OBJ::BasicStream<OBJ::NullStreamCallback> stream(data.data(), data.data() + data.size(), "benchmark", null);
+		FaceVertexRecorder recorder;
+		OBJ::Reader<FaceVertexRecorder, OBJ::BasicStream<OBJ::NullStreamCallback>> reader(recorder);
+		stream.consume(reader);
+		return std::move(recorder.keys);
+	}
+
+	// merges the face vertices like the consumer does, with the map reserved for num_reserved vertices up front;
+	// returns how many vertices there are
+	template <typename Map, typename Key>
+	std::size_t runVertexMap(const char* label, const std::vector<Key>& keys, std::size_t num_reserved = 0)
+	{
+		std::size_t num_vertices = 0;
+
+		auto t = bench::measure(10, [&]
+		{
+			Map vertex_map;
+			vertex_map.reserve(num_reserved);
+
+			for (const auto& key : keys)
+				vertex_map.try_emplace(key, static_cast<int>(vertex_map.size()));
+
+			num_vertices = vertex_map.size();
+		});
+
+		std::printf("%-32s min %9.3f ms  median %9.3f ms  %8.1f M lookups/s, %zu vertices\n", label, t.min, t.median, size(keys) / 1000.0 / t.min, num_vertices);
+		return num_vertices;
+	}
+
+	std::string readFile(const char* path)
+	{
+		std::ifstream file(path, std::ios::binary);
+
+		if (!file)
+			throw std::runtime_error("failed to open obj file");
+
+		return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+	}
+
+	std::string generateInput()
+	{
+		constexpr int GRID_SIZE = 500;
+
+		std::string data(bench::generateGrid(nullptr, GRID_SIZE), '\0');
+		bench::generateGrid(&data[0], GRID_SIZE);
+		return data;
+	}
+
+	// a grid whose vertex map and attributes take up more memory than a last-level cache holds, so that merging face
+	// vertices waits on memory, all the more if its faces are scattered
+	std::string generateLargeInput(bool scattered)
+	{
+		constexpr int GRID_SIZE = 1500;
+
+		std::string data(bench::generateGrid(nullptr, GRID_SIZE, scattered), '\0');
+		bench::generateGrid(&data[0], GRID_SIZE, scattered);
+		return data;
+	}
+
+	// faces whose vertices all start probing at the first group of the vertex map when they are hashed without a seed,
+	// as a file crafted against the hash would make them, or as many faces that are not picked for that
+	std::string generateCollidingInput(bool crafted)
+	{
+		constexpr int NUM_ATTRIBUTES = 1000;
+		constexpr int NUM_CORNERS = 30000;
+		constexpr std::uint64_t GROUP_MASK = (1 << 12) - 1;  // the groups of a table that holds NUM_CORNERS vertices
+
+		// hash_map picks the group by the bits above the 7 that go into the control byte
+		auto pick = [&](int v, int t, int n)
+		{
+			return !crafted || ((OBJ::vertex_key_hash {}(VertexKey::make(v - 1, n, t).pack()) >> 7) & GROUP_MASK) == 0;
+		};
+
+		std::string data(bench::generateFaces(nullptr, NUM_ATTRIBUTES, NUM_CORNERS, pick), '\0');
+		bench::generateFaces(&data[0], NUM_ATTRIBUTES, NUM_CORNERS, pick);
+		return data;
+	}
+
+	template <OBJ::Attributes A = OBJ::Attributes::ALL, typename Callback>
+	void run(const char* label, const std::string& data, Callback& callback, const OBJ::ReadOptions& options, int runs = 10)
+	{
+		auto t = bench::measure(runs, [&]
+		{
+			// the overload that reads all attributes through a StreamCallback is not a template
+			if constexpr (A == OBJ::Attributes::ALL)
+				OBJ::readTriangles(data.data(), data.data() + data.size(), "benchmark", callback, options);
+			else
+				OBJ::readTriangles<A>(data.data(), data.data() + data.size(), "benchmark", callback, options);
+		});
+
+		bench::report(label, t, data.size());
+	}
+
+	// includes getting the file into memory, which is what the file access modes differ in; a cold run has the file
+	// dropped from the cache first, which is timed as well
+	void runFile(const char* label, const char* path, std::size_t size, OBJ::FileAccess access, bool cold = false)
+	{
+		SilentStreamCallback silent;
+		OBJ::ReadOptions options;
+		options.file_access = access;
+
+		if (cold && !bench::dropFromCache(path))
+		{
+			std::printf("%-32s not supported\n", label);
+			return;
+		}
+
+		auto t = bench::measure(10, [&]
+		{
+			if (cold)
+				bench::dropFromCache(path);
+
+			OBJ::readTriangles(path, silent, options);
+		});
+
+		bench::report(label, t, size);
+	}
+
+	void runStreamed(const char* label, const std::string& data, const OBJ::ReadOptions& options)
+	{
+		SilentStreamCallback silent;
+
+		auto t = bench::measure(10, [&]
+		{
+			MemoryReadCallback input(data);
+			OBJ::readTriangles(input, "benchmark", silent, options);
+		});
+
+		bench::report(label, t, data.size());
+	}
+
+	void runProgressive(const char* label, const std::string& data, const OBJ::ReadOptions& options)
+	{
+		PreviewTimer timer;
+		double first_preview = 0.0;
+
+		auto t = bench::measure(10, [&]
+		{
+			timer.start = std::chrono::steady_clock::now();
+			timer.first_preview = -1.0;
+			OBJ::readTrianglesProgressive(data.data(), data.data() + data.size(), "benchmark", timer, options);
+			first_preview = timer.first_preview;
+		});
+
+		bench::report(label, t, data.size());
+		std::printf("%-32s first preview after %9.3f ms\n", label, first_preview);
+	}
+}
+
+int main(int argc, const char* argv[])
+{
+	try
+	{
+		if (argc > 2)
+		{
+			std::cerr << "usage: except_benchmark [<filename>]\n";
+			return -2;
+		}
+
+		auto data = argc > 1 ? readFile(argv[1]) : generateInput();
+
+		SilentStreamCallback silent;
+		OBJ::NullStreamCallback null;
+
+		run("virtual StreamCallback", data, silent, {});
+		run("NullStreamCallback", data, null, {});
+		run("virtual StreamCallback, indexed", data, silent, { 1, OBJ::Engine::INDEXED });
+		run("NullStreamCallback, indexed", data, null, { 1, OBJ::Engine::INDEXED });
+		run<OBJ::Attributes::POSITIONS>("NullStreamCallback, positions", data, null, {});
+		run<OBJ::Attributes::NORMALS>("NullStreamCallback, normals", data, null, {});
+		run<OBJ::Attributes::TEXCOORDS>("NullStreamCallback, texcoords", data, null, {});
+		runStreamed("streamed", data, {});
+		runProgressive("progressive", data, {});
+
+		{
+			auto keys = recordFaceVertices(data);
+			auto num_vertices = runVertexMap<std::unordered_map<VertexKey, int, OBJ::vertex_key_hash>>("dedup, unordered_map", keys);
+			runVertexMap<std::unordered_map<VertexKey, int, OBJ::vertex_key_hash>>("dedup, unordered_map, reserved", keys, num_vertices);
+			runVertexMap<hash_map<VertexKey, int, OBJ::vertex_key_hash>>("dedup, hash_map", keys);
+			runVertexMap<hash_map<VertexKey, int, OBJ::vertex_key_hash>>("dedup, hash_map, reserved", keys, num_vertices);
+
+			// the keys that the consumer looks up while the indices fit into 64 bits
+			std::vector<std::uint64_t> packed_keys;
+			for (const auto& key : keys)
+				packed_keys.push_back(key.pack());
+
+			runVertexMap<hash_map<std::uint64_t, int, OBJ::vertex_key_hash>>("dedup, packed keys", packed_keys);
+			runVertexMap<hash_map<std::uint64_t, int, OBJ::vertex_key_hash>>("dedup, packed keys, reserved", packed_keys, num_vertices);
+		}
+
+		{
+			auto scattered = generateCollidingInput(false);
+			auto crafted = generateCollidingInput(true);
+
+			std::random_device random;
+			OBJ::ReadOptions seeded;
+			seeded.hash_seed = std::uint64_t(random()) << 32 | random();
+
+			run("scattered faces", scattered, null, {});
+			run("crafted faces", crafted, null, {});
+			run("crafted faces, seeded", crafted, null, seeded);
+		}
+
+		// each of these takes seconds, fewer runs have to do
+		run("large grid", generateLargeInput(false), null, {}, 3);
+		run("large grid, scattered faces", generateLargeInput(true), null, {}, 3);
+
+		if (argc > 1)
+		{
+			runFile("file, read", argv[1], data.size(), OBJ::FileAccess::READ);
+			runFile("file, map", argv[1], data.size(), OBJ::FileAccess::MAP);
+			runFile("file, populate", argv[1], data.size(), OBJ::FileAccess::POPULATE);
+			runFile("file, stream", argv[1], data.size(), OBJ::FileAccess::STREAM);
+			runFile("cold file, read", argv[1], data.size(), OBJ::FileAccess::READ, true);
+			runFile("cold file, map", argv[1], data.size(), OBJ::FileAccess::MAP, true);
+			runFile("cold file, stream", argv[1], data.size(), OBJ::FileAccess::STREAM, true);
+		}
+
+		for (auto isa : parse::all_instruction_sets)
+		{
+			if (!parse::useKernels(isa))
+				continue;
+
+			auto label = "indexed, " + std::string(parse::name(isa)) + " kernels";
+			run(label.c_str(), data, null, { 1, OBJ::Engine::INDEXED });
+		}
+	}
+	catch (const OBJ::parse_error&)
+	{
+		std::cerr << "error: parse error\n";
+		return -1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return -1;
+	}
+
+	return 0;
+}
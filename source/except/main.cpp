@@ -1,53 +1,231 @@
-#include <stdexcept>
-#include <iterator>
-#include <iostream>
-
-#include "obj_stream_callback.h"
-#include "obj.h"
-
-
-namespace
-{
-	struct usage_error : std::runtime_error
-	{
-		using std::runtime_error::runtime_error;
-	};
-
-	std::ostream& printUsage(std::ostream& out)
-	{
-		return out << "objstat <filename>";
-	}
-}
-
-int main(int argc, const char* argv[])
-{
-	try
-	{
-		if (argc < 2)
-			throw usage_error("expected <filename>");
-		else if (argc > 2)
-			throw usage_error("too many arguments");
-
-		OBJ::StdoutStreamCallback callback;
-		auto obj = OBJ::readTriangles(argv[1], callback);
-
-		std::cout << size(obj.positions) << " positions, " << size(obj.normals) << " normals, " << size(obj.texcoords) << " texcoords, " << size(obj.triangles) << " triangles\n";
-	}
-	catch (const usage_error & e)
-	{
-		printUsage(std::cerr << "error: " << e.what() << '\n');
-		return -2;
-	}
-	catch (const std::exception& e)
-	{
-		std::cerr << e.what() << '\n';
-		return -1;
-	}
-	catch (...)
-	{
-		std::cerr << "error: unknown exception\n";
-		return -128;
-	}
-
-	return 0;
-}
+#include <cstdio>
+#include <stdexcept>
+#include <iterator>
+#include <iostream>
+#include <string_view>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+
+#include <parse/kernels.h>
+
+#include "obj_stream_callback.h"
+#include "obj_incremental.h"
+#include "obj.h"
+
+using namespace std::literals;
+
+
+namespace
+{
+	struct usage_error : std::runtime_error
+	{
+		using std::runtime_error::runtime_error;
+	};
+
+	std::ostream& printUsage(std::ostream& out)
+	{
+		return out << "objstat [-j <threads>] [-e reader|indexed] [-k scalar|sse2|avx2|avx512] [-f map|populate|read|stream] [-p|-t] <filename>|-";
+	}
+
+	int parseThreadCount(std::string_view arg)
+	{
+		int n;
+		if (auto [end, err] = std::from_chars(arg.data(), arg.data() + arg.size(), n); err != std::errc() || end != arg.data() + arg.size() || n < 0)
+			throw usage_error("invalid thread count");
+		return n;
+	}
+
+	OBJ::Engine parseEngine(std::string_view arg)
+	{
+		if (arg == "reader"sv)
+			return OBJ::Engine::READER;
+		else if (arg == "indexed"sv)
+			return OBJ::Engine::INDEXED;
+		throw usage_error("unknown engine");
+	}
+
+	OBJ::FileAccess parseFileAccess(std::string_view arg)
+	{
+		if (arg == "map"sv)
+			return OBJ::FileAccess::MAP;
+		else if (arg == "populate"sv)
+			return OBJ::FileAccess::POPULATE;
+		else if (arg == "read"sv)
+			return OBJ::FileAccess::READ;
+		else if (arg == "stream"sv)
+			return OBJ::FileAccess::STREAM;
+		throw usage_error("unknown file access");
+	}
+
+	// reports how long it took until each preview of a progressive load arrived
+	struct StdoutPreviewStreamCallback : OBJ::StdoutStreamCallback, OBJ::PreviewStreamCallback
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		void preview(const OBJ::Triangles& triangles, std::size_t face_stride) override
+		{
+			auto t = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "\rpreview after " << t << " ms: " << size(triangles.triangles) << " triangles from every " << face_stride << ". face\n";
+		}
+	};
+
+	// objstat - reads from stdin, one block at a time
+	struct StdinReadCallback : OBJ::ReadCallback
+	{
+		std::size_t read(char* buffer, std::size_t size) override
+		{
+			auto n = std::fread(buffer, 1, size, stdin);
+
+			if (n == 0 && std::ferror(stdin))
+				throw std::runtime_error("failed to read from stdin");
+
+			return n;
+		}
+	};
+
+	template <typename Triangles>
+	void printStatistics(const Triangles& obj)
+	{
+		std::cout << size(obj.positions) << " positions, " << size(obj.normals) << " normals, " << size(obj.texcoords) << " texcoords, " << size(obj.triangles) << " triangles\n";
+	}
+
+	// objstat -t follows the file, printing its statistics again whenever it changes, until it is interrupted
+	[[noreturn]] void tail(const char* filename, OBJ::StreamCallback& callback, const OBJ::ReadOptions& options)
+	{
+		OBJ::IncrementalOBJ obj(filename, callback, options);
+
+		for (;;)
+		{
+			std::cout << size(obj.positions()) << " positions, " << size(obj.normals()) << " normals, " << size(obj.texcoords()) << " texcoords, " << size(obj.triangles()) << " triangles" << std::endl;
+
+			for (;;)
+			{
+				if (!obj.waitForChange(std::chrono::seconds(1)))
+					continue;
+
+				try
+				{
+					if (obj.update() != OBJ::IncrementalOBJ::Change::NONE)
+						break;
+				}
+				catch (const OBJ::parse_error&)
+				{
+					// the callback has reported it, the next change reads the file again
+				}
+			}
+		}
+	}
+
+	// overrides the instruction set that is picked for the scanning kernels
+	void selectKernels(std::string_view arg)
+	{
+		auto isa = parse::parseInstructionSet(arg);
+
+		if (!isa)
+			throw usage_error("unknown instruction set");
+
+		if (!parse::useKernels(*isa))
+			throw usage_error("instruction set not supported");
+	}
+}
+
+int main(int argc, const char* argv[])
+{
+	try
+	{
+		OBJ::ReadOptions options;
+		const char* filename = nullptr;
+		bool progressive = false;
+		bool follow = false;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			if (argv[i] == "-j"sv)
+			{
+				if (++i >= argc)
+					throw usage_error("expected <threads>");
+				options.num_threads = parseThreadCount(argv[i]);
+			}
+			else if (argv[i] == "-e"sv)
+			{
+				if (++i >= argc)
+					throw usage_error("expected <engine>");
+				options.engine = parseEngine(argv[i]);
+			}
+			else if (argv[i] == "-k"sv)
+			{
+				if (++i >= argc)
+					throw usage_error("expected <instruction set>");
+				selectKernels(argv[i]);
+			}
+			else if (argv[i] == "-f"sv)
+			{
+				if (++i >= argc)
+					throw usage_error("expected <file access>");
+				options.file_access = parseFileAccess(argv[i]);
+			}
+			else if (argv[i] == "-p"sv)
+				progressive = true;
+			else if (argv[i] == "-t"sv)
+				follow = true;
+			else if (!filename)
+				filename = argv[i];
+			else
+				throw usage_error("too many arguments");
+		}
+
+		if (!filename)
+			throw usage_error("expected <filename>");
+
+		if (progressive && follow)
+			throw usage_error("-p and -t cannot be combined");
+
+		StdoutPreviewStreamCallback callback;
+		OBJ::Triangles obj;
+
+		if (filename == "-"sv)
+		{
+			if (progressive)
+				throw usage_error("stdin cannot be read progressively");
+
+			if (follow)
+				throw usage_error("stdin cannot be followed");
+
+			StdinReadCallback input;
+			obj = OBJ::readTriangles(input, "stdin", callback, options);
+		}
+		else if (follow)
+			tail(filename, callback, options);
+		else if (progressive)
+			obj = OBJ::readTrianglesProgressive(filename, callback, options);
+		else if (std::error_code ec; OBJ::needsWideIndices(std::filesystem::file_size(filename, ec)) && !ec)
+		{
+			// only files that could have more vertices than an int can index pay for 64-bit indices
+			printStatistics(OBJ::readTriangles64(filename, callback, options));
+			return 0;
+		}
+		else
+			obj = OBJ::readTriangles(filename, callback, options);
+
+		printStatistics(obj);
+	}
+	catch (const usage_error & e)
+	{
+		printUsage(std::cerr << "error: " << e.what() << '\n');
+		return -2;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return -1;
+	}
+	catch (...)
+	{
+		std::cerr << "error: unknown exception\n";
+		return -128;
+	}
+
+	return 0;
+}
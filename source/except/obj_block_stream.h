@@ -0,0 +1,120 @@
+#ifndef INCLUDED_OBJ_BLOCK_STREAM
+#define INCLUDED_OBJ_BLOCK_STREAM
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#include <parse/kernels.h>
+
+#include "obj_stream.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	// a BasicStream over input that is pulled from a ReadCallback one block at a time; only the complete lines in the
+	// buffer are parsed, the partial line at its end is moved to the front and completed by the next block, so the
+	// buffer only has to hold about two blocks, or the longest line. Names that statements hand to the consumer are
+	// only valid until it returns. Progress is not reported, as the length of the input is not known
+	template <typename Callback>
+	class BasicBlockStream : public BasicStream<Callback>
+	{
+		ReadCallback& input;
+		std::size_t block_size;
+		std::size_t capacity;
+		std::unique_ptr<char[]> buffer;
+		char* data_end;  // the input that has been read so far, lines are parsed up to the last newline before it
+		bool input_end = false;
+
+		// makes room for another block behind the data in the buffer
+		void reserveBlock()
+		{
+			std::size_t size = data_end - &buffer[0];
+
+			if (capacity - size >= block_size)
+				return;
+
+			while (capacity - size < block_size)
+				capacity *= 2;
+
+			auto grown = std::unique_ptr<char[]> { new char[capacity] };
+			std::memcpy(&grown[0], &buffer[0], size);
+			buffer = std::move(grown);
+			data_end = &buffer[0] + size;
+		}
+
+		// replaces the lines that have been parsed with the next ones; returns false at the end of the input
+		bool refill()
+		{
+			// the lines that are dropped can no longer be counted when an error is reported
+			this->line += static_cast<std::int64_t>(parse::activeKernels().countNewlines(this->counted, this->end));
+
+			std::size_t carry = data_end - this->end;
+			std::memmove(&buffer[0], this->end, carry);
+			data_end = &buffer[0] + carry;
+
+			std::size_t window = 0;  // the complete lines at the front of the buffer
+
+			while (!input_end && window == 0)
+			{
+				reserveBlock();
+
+				std::size_t block = data_end - &buffer[0];
+				std::size_t n = input.read(data_end, block_size);
+
+				data_end += n;
+				input_end = n == 0;
+
+				// only the new block can have a newline, the carried over line has none
+				for (std::size_t p = block + n; p != block; --p)
+				{
+					if (buffer[p - 1] == '\n')
+					{
+						window = p;
+						break;
+					}
+				}
+			}
+
+			if (input_end)
+				window = data_end - &buffer[0];
+
+			this->ptr = &buffer[0];
+			this->end = &buffer[0] + window;
+			this->next_progress = this->end;
+			this->counted = &buffer[0];
+
+			return this->ptr != this->end;
+		}
+
+	public:
+		using BasicStream<Callback>::consume;
+
+		BasicBlockStream(ReadCallback& input, std::size_t block_size, std::string_view name, Callback& callback)
+			: BasicStream<Callback>(nullptr, nullptr, name, callback), input(input), block_size(block_size != 0 ? block_size : 1), capacity(2 * this->block_size), buffer(new char[capacity]), data_end(&buffer[0])
+		{
+			this->ptr = this->end = this->counted = &buffer[0];
+		}
+
+		template <typename Consumer>
+		void consume(Consumer&& consumer)
+		{
+			while (refill())
+			{
+				if (!this->consumeStatements(*this, consumer))
+					return;
+			}
+
+			consumer.finish(*this);
+			this->endFile();
+		}
+	};
+
+	using BlockStream = BasicBlockStream<StreamCallback>;
+}
+
+#endif  // INCLUDED_OBJ_BLOCK_STREAM
@@ -0,0 +1,486 @@
+#ifndef INCLUDED_OBJ_CONSUMER
+#define INCLUDED_OBJ_CONSUMER
+
+#pragma once
+
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <parse/bits.h>
+
+#include "hash_map.h"
+#include "obj_stream.h"
+#include "obj_batch.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	// the indices of a face vertex that tell output vertices apart, leaving out those of attributes that are not read
+	template <Attributes A, typename Index = int>
+	struct vertex_key
+	{
+		static constexpr std::size_t size = 1 + reads(A, Attributes::NORMALS) + reads(A, Attributes::TEXCOORDS);
+
+		Index indices[size];
+
+		// how many bits every index gets in a packed key, which they only fit into if they are not negative
+		static constexpr int packed_bits = 64 / size;
+		static constexpr std::uint64_t packed_mask = ~std::uint64_t(0) >> (64 - packed_bits);
+
+		static vertex_key make(Index v, Index n, Index t)
+		{
+			vertex_key key = { { v } };
+			std::size_t i = 1;
+
+			if constexpr (reads(A, Attributes::NORMALS))
+				key.indices[i++] = n;
+
+			if constexpr (reads(A, Attributes::TEXCOORDS))
+				key.indices[i++] = t;
+
+			return key;
+		}
+
+		// whether the indices fit into a 64-bit key, which they always do if they are small enough to be packed as they are
+		bool packable() const
+		{
+			if constexpr (packed_bits < 8 * sizeof(Index))
+			{
+				for (std::size_t i = 0; i < size; ++i)
+					if (static_cast<std::make_unsigned_t<Index>>(indices[i]) > packed_mask)
+						return false;
+			}
+			return true;
+		}
+
+		std::uint64_t pack() const
+		{
+			std::uint64_t key = 0;
+
+			for (std::size_t i = 0; i < size; ++i)
+				key |= (static_cast<std::make_unsigned_t<Index>>(indices[i]) & packed_mask) << (i * packed_bits);
+
+			return key;
+		}
+
+		static vertex_key unpack(std::uint64_t packed)
+		{
+			vertex_key key;
+
+			for (std::size_t i = 0; i < size; ++i)
+				key.indices[i] = static_cast<Index>(static_cast<std::make_unsigned_t<Index>>((packed >> (i * packed_bits)) & packed_mask));
+
+			return key;
+		}
+
+		friend bool operator ==(const vertex_key& a, const vertex_key& b)
+		{
+			for (std::size_t i = 0; i < size; ++i)
+				if (a.indices[i] != b.indices[i])
+					return false;
+			return true;
+		}
+	};
+
+	// hashes vertex keys and packed ones with multiply-xorshift rounds, which leave every bit of the hash depending on
+	// every bit of the key; starting from a seed that is picked at random for a load keeps files that were crafted to
+	// make the keys of a known hash collide from doing so
+	struct vertex_key_hash
+	{
+		using is_avalanching = void;
+
+		std::uint64_t seed = 0;
+
+		static std::uint64_t mix(std::uint64_t h)
+		{
+			h ^= h >> 32;
+			h *= 0xD6E8FEB86659FD93ULL;
+			h ^= h >> 32;
+			h *= 0xD6E8FEB86659FD93ULL;
+			return h ^ (h >> 32);
+		}
+
+		std::size_t operator ()(std::uint64_t packed) const
+		{
+			return static_cast<std::size_t>(mix(packed ^ seed));
+		}
+
+		template <Attributes A, typename Index>
+		std::size_t operator ()(const vertex_key<A, Index>& key) const
+		{
+			std::uint64_t h = seed;
+
+			for (std::size_t i = 0; i < vertex_key<A, Index>::size; ++i)
+				h = mix(h ^ static_cast<std::uint64_t>(key.indices[i]));
+
+			return static_cast<std::size_t>(h);
+		}
+	};
+
+
+	// collects the triangles of an OBJ file, keeping only the vertex attributes A besides positions; Index has to be
+	// wide enough for the number of vertices, which int is unless the input is larger than needsWideIndices allows
+	template <Attributes A, typename Index = int>
+	class BasicOBJConsumer
+	{
+	protected:
+		static constexpr bool reads_normals = reads(A, Attributes::NORMALS);
+		static constexpr bool reads_texcoords = reads(A, Attributes::TEXCOORDS);
+
+		std::vector<float3> v;
+		std::vector<float3> vn;
+		std::vector<float2> vt;
+
+		// face vertices are looked up by their keys packed into 64 bits until one of them does not fit, from then on
+		// all of them are looked up by their keys as they are
+		hash_map<std::uint64_t, Index, vertex_key_hash> packed_vertex_map;
+		hash_map<vertex_key<A, Index>, Index, vertex_key_hash> vertex_map;
+		bool packed_keys = true;
+
+		std::vector<float3> positions;
+		std::vector<float3> normals;
+		std::vector<float2> texcoords;
+		std::vector<std::array<Index, 3>> triangles;
+
+		static constexpr int MAX_FACE_VERTICES = 7;
+
+		// face vertices are merged in batches of about this many, once their faces are complete, so that the memory
+		// accesses of all their lookups can be under way at the same time
+		static constexpr int FACE_VERTEX_BATCH_SIZE = 64;
+
+		// the face vertices of the face that is being read and of the faces that are waiting to be merged, with their
+		// relative indices already resolved
+		basic_face_vertex<Index> face_vertices[MAX_FACE_VERTICES];
+		int num_face_vertices = 0;
+
+		basic_face_vertex<Index> pending_face_vertices[FACE_VERTEX_BATCH_SIZE + MAX_FACE_VERTICES - 1];
+		std::uint8_t pending_face_sizes[FACE_VERTEX_BATCH_SIZE];
+		int num_pending_face_vertices = 0;
+		int num_pending_faces = 0;
+
+		template <typename Stream>
+		static void checkFaceVertexCount(Stream& stream, int num_face_vertices)
+		{
+			if (num_face_vertices >= MAX_FACE_VERTICES)
+				stream.throwError("this face has too many vertices"sv);
+		}
+
+		template <typename Stream>
+		static void checkFaceSize(Stream& stream, int num_face_vertices)
+		{
+			if (num_face_vertices < 3)
+				stream.throwError("face must have at least three vertices"sv);
+		}
+
+		void unpackKeys()
+		{
+			vertex_map.reserve(packed_vertex_map.size() + 1);
+			packed_vertex_map.forEach([&](const auto& vertex) { vertex_map.try_emplace(vertex_key<A, Index>::unpack(vertex.first), vertex.second); });
+
+			packed_vertex_map = {};
+			packed_keys = false;
+		}
+
+		// the face vertex with its indices relative to the attributes read so far turned into ones that index v, vn and vt
+		basic_face_vertex<Index> resolveFaceVertex(Index vi, Index ni, Index ti) const
+		{
+			if (vi < 0)
+				vi = static_cast<Index>(size(v)) + vi;
+			else
+				--vi;
+
+			if (reads_normals && ni < 0)
+				ni = static_cast<Index>(size(vn)) + ni;
+
+			if (reads_texcoords && ti < 0)
+				ti = static_cast<Index>(size(vt)) + ti;
+
+			return { vi, ni, ti };
+		}
+
+		template <typename T>
+		static void prefetchAttribute(const std::vector<T>& attributes, Index i)
+		{
+			if (static_cast<std::make_unsigned_t<Index>>(i) < size(attributes))
+				parse::prefetch(&attributes[i]);
+		}
+
+		// merges the pending face vertices through map, which takes the keys that make_key turns them into, in three
+		// passes that each only touch memory the one before asked for: the groups their lookups start at and the
+		// attributes they would copy, then the slots in these groups they would end at, then the lookups themselves
+		template <typename Map, typename MakeKey>
+		void mergeFaceVertices(Map& map, MakeKey&& make_key, Index* merged)
+		{
+			int count = num_pending_face_vertices;
+			std::uint64_t hashes[FACE_VERTEX_BATCH_SIZE + MAX_FACE_VERTICES - 1];
+
+			// growing the table halfway through would lose what was prefetched
+			map.reserve(map.size() + count);
+
+			for (int i = 0; i < count; ++i)
+			{
+				const auto& fv = pending_face_vertices[i];
+
+				hashes[i] = map.hashOf(make_key(fv));
+				map.prefetchGroup(hashes[i]);
+
+				prefetchAttribute(v, fv.v);
+
+				if constexpr (reads_normals)
+					prefetchAttribute(vn, fv.n);
+
+				if constexpr (reads_texcoords)
+					prefetchAttribute(vt, fv.t);
+			}
+
+			for (int i = 0; i < count; ++i)
+				map.prefetchSlot(hashes[i]);
+
+			for (int i = 0; i < count; ++i)
+			{
+				const auto& fv = pending_face_vertices[i];
+				auto [vertex, inserted] = map.try_emplace_hashed(hashes[i], make_key(fv), static_cast<Index>(size(positions)));
+
+				if (inserted)
+				{
+					positions.push_back(v[fv.v]);
+
+					if constexpr (reads_normals)
+						normals.push_back(vn[fv.n]);
+
+					if constexpr (reads_texcoords)
+						texcoords.push_back(vt[fv.t]);
+				}
+
+				merged[i] = vertex->second;
+			}
+		}
+
+	public:
+		static constexpr Attributes attributes = A;
+		using index_type = Index;
+
+		// hash_seed is mixed into the hashes of the face vertices, see vertex_key_hash
+		explicit BasicOBJConsumer(std::uint64_t hash_seed = 0)
+			: vn {{ 0.0f, 0.0f, 0.0f }}, vt {{ 0.0f, 0.0f }}, packed_vertex_map(vertex_key_hash { hash_seed }), vertex_map(vertex_key_hash { hash_seed })
+		{
+		}
+
+		template <typename Stream>
+		void consumeVertex(Stream& stream, float x, float y, float z)
+		{
+			v.emplace_back(x, y, z);
+		}
+
+		template <typename Stream>
+		void consumeVertices(Stream& stream, const float3* vertices, std::size_t count)
+		{
+			v.insert(end(v), vertices, vertices + count);
+		}
+
+		template <typename Stream>
+		void consumeVertex(Stream& stream, float x, float y, float z, float w)
+		{
+			stream.throwError("weighted vertex coordinates are not supported"sv);
+		}
+
+		template <typename Stream>
+		void consumeNormal(Stream& stream, float x, float y, float z)
+		{
+			vn.emplace_back(x, y, z);
+		}
+
+		template <typename Stream>
+		void consumeNormals(Stream& stream, const float3* normals, std::size_t count)
+		{
+			vn.insert(end(vn), normals, normals + count);
+		}
+
+		template <typename Stream>
+		void consumeTexcoord(Stream& stream, float u)
+		{
+			stream.throwError("1D texture coordinates are not supported"sv);
+		}
+
+		template <typename Stream>
+		void consumeTexcoord(Stream& stream, float u, float v)
+		{
+			vt.emplace_back(u, 1.0f - v);
+		}
+
+		template <typename Stream>
+		void consumeTexcoords(Stream& stream, const float2* texcoords, std::size_t count)
+		{
+			auto first = vt.insert(end(vt), texcoords, texcoords + count);
+
+			for (auto t = first; t != end(vt); ++t)
+				t->y = 1.0f - t->y;
+		}
+
+		template <typename Stream>
+		void consumeTexcoord(Stream& stream, float u, float v, float w)
+		{
+			stream.throwError("3D texture coordinates are not supported"sv);
+		}
+
+		template <typename Stream>
+		void consumeFaceVertex(Stream& stream, Index vi, Index ni, Index ti)
+		{
+			checkFaceVertexCount(stream, num_face_vertices);
+			face_vertices[num_face_vertices++] = resolveFaceVertex(vi, ni, ti);
+		}
+
+		template <typename Stream>
+		void consumeFaceVertices(Stream& stream, const basic_face_vertex<Index>* vertices, int count)
+		{
+			// the face is rejected as a whole if it gets too many vertices, so the check can be done once up front
+			checkFaceVertexCount(stream, num_face_vertices + count - 1);
+
+			for (int i = 0; i < count; ++i)
+				face_vertices[num_face_vertices + i] = resolveFaceVertex(vertices[i].v, vertices[i].n, vertices[i].t);
+
+			num_face_vertices += count;
+		}
+
+		template <typename Stream>
+		void finishFace(Stream& stream)
+		{
+			checkFaceSize(stream, num_face_vertices);
+
+			std::copy(face_vertices, face_vertices + num_face_vertices, pending_face_vertices + num_pending_face_vertices);
+			num_pending_face_vertices += num_face_vertices;
+
+			pending_face_sizes[num_pending_faces++] = static_cast<std::uint8_t>(num_face_vertices);
+			num_face_vertices = 0;
+
+			if (num_pending_face_vertices >= FACE_VERTEX_BATCH_SIZE)
+				mergeFaces();
+		}
+
+		// merges the vertices of the faces that have been read and adds their triangles; the output vertices and triangles
+		// are only complete after this
+		void mergeFaces()
+		{
+			if (num_pending_faces == 0)
+				return;
+
+			if (packed_keys)
+			{
+				for (int i = 0; i < num_pending_face_vertices; ++i)
+				{
+					const auto& fv = pending_face_vertices[i];
+
+					if (!vertex_key<A, Index>::make(fv.v, fv.n, fv.t).packable())
+					{
+						unpackKeys();
+						break;
+					}
+				}
+			}
+
+			Index merged[FACE_VERTEX_BATCH_SIZE + MAX_FACE_VERTICES - 1];
+
+			if (packed_keys)
+				mergeFaceVertices(packed_vertex_map, [](const basic_face_vertex<Index>& fv) { return vertex_key<A, Index>::make(fv.v, fv.n, fv.t).pack(); }, merged);
+			else
+				mergeFaceVertices(vertex_map, [](const basic_face_vertex<Index>& fv) { return vertex_key<A, Index>::make(fv.v, fv.n, fv.t); }, merged);
+
+			const Index* face = merged;
+			for (int f = 0; f < num_pending_faces; ++f)
+			{
+				for (int i = 2; i < pending_face_sizes[f]; ++i)
+					triangles.push_back({ face[0], face[i - 1], face[i] });
+
+				face += pending_face_sizes[f];
+			}
+
+			num_pending_face_vertices = 0;
+			num_pending_faces = 0;
+		}
+
+		template <typename Stream>
+		void consumeObjectName(Stream& stream, std::string_view name)
+		{
+		}
+
+		template <typename Stream>
+		void consumeGroupName(Stream& stream, std::string_view name)
+		{
+		}
+
+		template <typename Stream>
+		void finishGroupAssignment(Stream& streame)
+		{
+		}
+
+		template <typename Stream>
+		void consumeSmoothingGroup(Stream& stream, int n)
+		{
+			stream.warn("smoothing groups are ignored!"sv);
+		}
+
+		template <typename Stream>
+		void consumeMtlLib(Stream& stream, std::string_view name)
+		{
+			stream.warn("materials are ignored!"sv);
+		}
+
+		template <typename Stream>
+		void consumeUseMtl(Stream& stream, std::string_view name)
+		{
+			stream.warn("materials are ignored!"sv);
+		}
+
+		// makes room for num_vertices output vertices, so that merging face vertices does not have to grow the table
+		// until there are more
+		void reserveVertices(std::size_t num_vertices)
+		{
+			if (packed_keys)
+				packed_vertex_map.reserve(num_vertices);
+			else
+				vertex_map.reserve(num_vertices);
+
+			positions.reserve(num_vertices);
+
+			if constexpr (reads_normals)
+				normals.reserve(num_vertices);
+
+			if constexpr (reads_texcoords)
+				texcoords.reserve(num_vertices);
+		}
+
+		// takes over the vertex attributes collected by another consumer, as if they had been consumed by this one
+		void appendAttributes(BasicOBJConsumer&& other)
+		{
+			v.insert(end(v), begin(other.v), end(other.v));
+			vn.insert(end(vn), begin(other.vn) + 1, end(other.vn));
+			vt.insert(end(vt), begin(other.vt) + 1, end(other.vt));
+		}
+
+		OBJ::BasicTriangles<A, Index> finish()
+		{
+			mergeFaces();
+
+			OBJ::BasicTriangles<A, Index> out;
+
+			out.positions = std::move(positions);
+
+			if constexpr (reads_normals)
+				out.normals = std::move(normals);
+
+			if constexpr (reads_texcoords)
+				out.texcoords = std::move(texcoords);
+
+			out.triangles = std::move(triangles);
+			return out;
+		}
+	};
+
+	using OBJConsumer = BasicOBJConsumer<Attributes::ALL>;
+}
+
+#endif  // INCLUDED_OBJ_CONSUMER
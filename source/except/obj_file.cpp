@@ -0,0 +1,598 @@
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <cerrno>
+#include <stdexcept>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <system_error>
+#include <exception>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+#endif
+
+#include "obj_file.h"
+
+
+namespace
+{
+	// the size of the buffer that files are read into at first when it is not known how large they are
+	constexpr std::size_t MIN_READ_BUFFER_SIZE = 1 << 16;
+
+	// the blocks a ReadAheadFile cycles through: one being parsed, one being read and one in between for the
+	// times either side is slower
+	constexpr int NUM_READ_AHEAD_BLOCKS = 3;
+
+	// how often either side of a ReadAheadFile checks for the other before it goes to sleep
+	constexpr int SPIN_COUNT = 64;
+
+	// how often a FileWatch looks at the file where the system cannot tell it about changes
+	constexpr std::chrono::milliseconds POLL_INTERVAL { 50 };
+
+#if defined(_WIN32)
+	struct File
+	{
+		HANDLE handle;
+
+		explicit File(const std::filesystem::path& path)
+			: handle(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr))
+		{
+			if (handle == INVALID_HANDLE_VALUE)
+				throw std::runtime_error("failed to open obj file");
+		}
+
+		~File()
+		{
+			CloseHandle(handle);
+		}
+
+		File(const File&) = delete;
+		File& operator =(const File&) = delete;
+
+		// the size of the file if it is one that can be mapped, 0 otherwise
+		std::size_t mappableSize() const
+		{
+			LARGE_INTEGER size;
+			if (GetFileType(handle) != FILE_TYPE_DISK || !GetFileSizeEx(handle, &size))
+				return 0;
+			return static_cast<std::size_t>(size.QuadPart);
+		}
+
+		const char* map(std::size_t size, OBJ::FileAccess access) const
+		{
+			HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+			if (!mapping)
+				return nullptr;
+
+			// the view keeps the mapping alive
+			void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+			CloseHandle(mapping);
+
+#if defined(_WIN32_WINNT_WIN8) && _WIN32_WINNT >= _WIN32_WINNT_WIN8
+			if (data && access == OBJ::FileAccess::POPULATE)
+			{
+				WIN32_MEMORY_RANGE_ENTRY range = { data, size };
+				PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+			}
+#endif
+
+			return static_cast<const char*>(data);
+		}
+
+		void adviseSequential() const noexcept
+		{
+			// the file was opened with FILE_FLAG_SEQUENTIAL_SCAN
+		}
+
+		std::uint64_t identity() const
+		{
+			BY_HANDLE_FILE_INFORMATION info;
+			if (!GetFileInformationByHandle(handle, &info))
+				return 0;
+			return (static_cast<std::uint64_t>(info.nFileIndexHigh) << 32 | info.nFileIndexLow) ^ (static_cast<std::uint64_t>(info.dwVolumeSerialNumber) << 40);
+		}
+
+		static void unmap(const char* data, std::size_t size)
+		{
+			UnmapViewOfFile(data);
+		}
+
+		// reads from offset if the file is seekable, from wherever the last read stopped otherwise; returns -1 if reading failed
+		std::ptrdiff_t read(char* buffer, std::size_t size, std::uint64_t offset, bool seekable) const noexcept
+		{
+			OVERLAPPED position = {};
+			position.Offset = static_cast<DWORD>(offset);
+			position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+			DWORD read;
+			if (!ReadFile(handle, buffer, static_cast<DWORD>(size < MAXDWORD ? size : MAXDWORD), &read, seekable ? &position : nullptr))
+			{
+				// the write end of a pipe being closed is how pipes end
+				return GetLastError() == ERROR_BROKEN_PIPE || GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+			}
+			return read;
+		}
+	};
+#else
+	struct File
+	{
+		int fd;
+
+		explicit File(const std::filesystem::path& path)
+			: fd(open(path.c_str(), O_RDONLY | O_CLOEXEC))
+		{
+			if (fd < 0)
+				throw std::runtime_error("failed to open obj file");
+		}
+
+		~File()
+		{
+			close(fd);
+		}
+
+		File(const File&) = delete;
+		File& operator =(const File&) = delete;
+
+		// the size of the file if it is one that can be mapped, 0 otherwise
+		std::size_t mappableSize() const
+		{
+			struct stat info;
+			if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+				return 0;
+			return static_cast<std::size_t>(info.st_size);
+		}
+
+		const char* map(std::size_t size, OBJ::FileAccess access) const
+		{
+			int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+			if (access == OBJ::FileAccess::POPULATE)
+				flags |= MAP_POPULATE;
+#endif
+
+			void* data = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+
+			if (data == MAP_FAILED)
+				return nullptr;
+
+			// the file is parsed front to back, pages behind the parser can go as soon as the system needs them
+			madvise(data, size, MADV_SEQUENTIAL);
+			madvise(data, size, MADV_WILLNEED);
+#if defined(MADV_HUGEPAGE)
+			if (access == OBJ::FileAccess::POPULATE)
+				madvise(data, size, MADV_HUGEPAGE);
+#endif
+
+			return static_cast<const char*>(data);
+		}
+
+		void adviseSequential() const noexcept
+		{
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		}
+
+		std::uint64_t identity() const
+		{
+			struct stat info;
+			if (fstat(fd, &info) != 0)
+				return 0;
+			return static_cast<std::uint64_t>(info.st_ino) ^ (static_cast<std::uint64_t>(info.st_dev) << 40);
+		}
+
+		static void unmap(const char* data, std::size_t size)
+		{
+			munmap(const_cast<char*>(data), size);
+		}
+
+		// reads from offset if the file is seekable, from wherever the last read stopped otherwise; returns -1 if reading failed
+		std::ptrdiff_t read(char* buffer, std::size_t size, std::uint64_t offset, bool seekable) const noexcept
+		{
+			for (;;)
+			{
+				if (auto n = seekable ? pread(fd, buffer, size, static_cast<off_t>(offset)) : ::read(fd, buffer, size); n >= 0 || errno != EINTR)
+					return n;
+			}
+		}
+	};
+#endif
+
+	// copies the file from offset to its end into buffer, which it grows as needed, and returns how much that was;
+	// expected_size is what the file is supposed to have from offset on, 0 if that is not known. Reading from the start
+	// does not seek, which pipes cannot
+	std::size_t readToEnd(const File& file, std::uint64_t offset, std::size_t expected_size, std::unique_ptr<char[]>& buffer)
+	{
+		// reading one byte more than the file is supposed to have finds its end without having to grow the buffer
+		std::size_t capacity = expected_size < MIN_READ_BUFFER_SIZE ? MIN_READ_BUFFER_SIZE : expected_size + 1;
+		std::size_t size = 0;
+		buffer.reset(new char[capacity]);
+
+		for (;;)
+		{
+			auto n = file.read(&buffer[size], capacity - size, offset + size, offset != 0);
+
+			if (n < 0)
+				throw std::runtime_error("failed to read obj file");
+
+			if (n == 0)
+				return size;
+
+			size += static_cast<std::size_t>(n);
+
+			if (size == capacity)
+			{
+				auto grown = std::unique_ptr<char[]> { new char[capacity * 2] };
+				std::memcpy(&grown[0], &buffer[0], size);
+				buffer = std::move(grown);
+				capacity *= 2;
+			}
+		}
+	}
+}
+
+namespace OBJ
+{
+	InputFile::InputFile(const std::filesystem::path& path, FileAccess access)
+	{
+		File file(path);
+
+		auto file_size = file.mappableSize();
+
+		if (access != FileAccess::READ && file_size != 0)
+		{
+			if (auto mapping = file.map(file_size, access))
+			{
+				data = mapping;
+				size = file_size;
+				mapped = true;
+				return;
+			}
+		}
+
+		size = readToEnd(file, 0, file_size, buffer);
+		data = &buffer[0];
+	}
+
+	InputFile::~InputFile()
+	{
+		if (mapped)
+			File::unmap(data, size);
+	}
+
+	FileTail::FileTail(const std::filesystem::path& path, std::uint64_t offset)
+	{
+		File file(path);
+
+		file_id = file.identity();
+		file_size = file.mappableSize();
+
+		// files that cannot be mapped cannot be read from an offset either, they only ever have a start
+		if (file_size < offset || (file_size == 0 && offset != 0))
+		{
+			buffer.reset(new char[1]);
+			return;
+		}
+
+		size = readToEnd(file, offset, static_cast<std::size_t>(file_size - offset), buffer);
+		file_size = offset + size;
+	}
+
+#if defined(__linux__)
+	// watches the directory of the file rather than the file itself, which saving another one over it would end
+	class FileWatch::Watch
+	{
+		int fd;
+		std::string name;
+
+	public:
+		explicit Watch(const std::filesystem::path& path)
+			: fd(inotify_init1(IN_CLOEXEC)), name(path.filename().native())
+		{
+			if (fd < 0)
+				throw std::runtime_error("failed to watch obj file");
+
+			auto directory = path.parent_path();
+
+			if (inotify_add_watch(fd, directory.empty() ? "." : directory.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_ATTRIB) < 0)
+			{
+				close(fd);
+				throw std::runtime_error("failed to watch obj file");
+			}
+		}
+
+		~Watch()
+		{
+			close(fd);
+		}
+
+		bool wait(std::chrono::milliseconds timeout)
+		{
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+
+			for (;;)
+			{
+				auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+				pollfd events = { fd, POLLIN, 0 };
+
+				if (int ret = poll(&events, 1, left > 0 ? static_cast<int>(left) : 0); ret <= 0)
+				{
+					if (ret < 0 && errno == EINTR)
+						continue;
+					return false;
+				}
+
+				alignas(inotify_event) char buffer[4096];
+				auto n = ::read(fd, buffer, sizeof(buffer));
+
+				if (n <= 0)
+					return false;
+
+				bool changed = false;
+
+				for (char* p = buffer; p < buffer + n; )
+				{
+					auto event = reinterpret_cast<const inotify_event*>(p);
+
+					if (event->len != 0 && name == event->name)
+						changed = true;
+
+					p += sizeof(inotify_event) + event->len;
+				}
+
+				if (changed)
+					return true;
+			}
+		}
+	};
+#else
+	class FileWatch::Watch
+	{
+		std::filesystem::path path;
+		std::uintmax_t size;
+		std::filesystem::file_time_type time;
+
+		bool changed()
+		{
+			std::error_code err;
+			auto new_size = std::filesystem::file_size(path, err);
+			auto new_time = std::filesystem::last_write_time(path, err);
+
+			if (new_size == size && new_time == time)
+				return false;
+
+			size = new_size;
+			time = new_time;
+			return true;
+		}
+
+	public:
+		explicit Watch(const std::filesystem::path& path)
+			: path(path)
+		{
+			changed();
+		}
+
+		bool wait(std::chrono::milliseconds timeout)
+		{
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+
+			while (!changed())
+			{
+				if (std::chrono::steady_clock::now() >= deadline)
+					return false;
+
+				std::this_thread::sleep_for(POLL_INTERVAL);
+			}
+
+			return true;
+		}
+	};
+#endif
+
+	FileWatch::FileWatch(const std::filesystem::path& path)
+		: watch(new Watch(path))
+	{
+	}
+
+	FileWatch::~FileWatch() = default;
+
+	bool FileWatch::wait(std::chrono::milliseconds timeout)
+	{
+		return watch->wait(timeout);
+	}
+
+	// the reading thread fills the blocks in turn and publishes them through filled, the parsing one hands them back
+	// through released; the mutex is only taken to sleep when one side is waiting for the other
+	class ReadAhead::Pipeline
+	{
+		struct block
+		{
+			std::unique_ptr<char[]> data;
+			std::size_t size;  // 0 marks the end of the input
+		};
+
+		GzipReadCallback input;
+		std::size_t block_size;
+		block blocks[NUM_READ_AHEAD_BLOCKS];
+
+		std::atomic<std::size_t> filled { 0 };
+		std::atomic<std::size_t> released { 0 };
+		std::atomic<bool> stopped { false };
+		std::exception_ptr failure;  // published by the end of the input
+
+		std::atomic<int> sleepers { 0 };
+		std::mutex mutex;
+		std::condition_variable wakeup;
+
+		std::size_t next = 0;    // the block the parser takes from next
+		std::size_t offset = 0;  // how much of it has been taken
+
+		std::thread reader;
+
+		template <typename Ready>
+		void wait(Ready&& ready)
+		{
+			for (int i = 0; i < SPIN_COUNT; ++i)
+				if (ready())
+					return;
+
+			std::unique_lock lock(mutex);
+			++sleepers;
+			wakeup.wait(lock, ready);
+			--sleepers;
+		}
+
+		void notify()
+		{
+			if (sleepers != 0)
+			{
+				std::lock_guard lock(mutex);
+				wakeup.notify_all();
+			}
+		}
+
+		void readAhead()
+		{
+			for (std::size_t i = 0; ; ++i)
+			{
+				wait([&] { return i - released < NUM_READ_AHEAD_BLOCKS || stopped; });
+
+				if (stopped)
+					return;
+
+				auto& b = blocks[i % NUM_READ_AHEAD_BLOCKS];
+
+				try
+				{
+					b.size = input.read(&b.data[0], block_size);
+				}
+				catch (...)
+				{
+					failure = std::current_exception();
+					b.size = 0;
+				}
+
+				filled = i + 1;
+				notify();
+
+				if (b.size == 0)
+					return;
+			}
+		}
+
+	public:
+		Pipeline(ReadCallback& source, std::size_t block_size)
+			: input(source), block_size(block_size != 0 ? block_size : 1)
+		{
+			for (auto& b : blocks)
+				b.data.reset(new char[this->block_size]);
+
+			reader = std::thread([this] { readAhead(); });
+		}
+
+		~Pipeline()
+		{
+			stopped = true;
+
+			{
+				std::lock_guard lock(mutex);
+				wakeup.notify_all();
+			}
+
+			reader.join();
+		}
+
+		std::size_t read(char* buffer, std::size_t size)
+		{
+			wait([&] { return filled > next; });
+
+			auto& b = blocks[next % NUM_READ_AHEAD_BLOCKS];
+
+			if (b.size == 0)
+			{
+				if (failure)
+					std::rethrow_exception(failure);
+				return 0;
+			}
+
+			auto n = std::min(size, b.size - offset);
+			std::memcpy(buffer, &b.data[offset], n);
+			offset += n;
+
+			if (offset == b.size)
+			{
+				offset = 0;
+				released = ++next;
+				notify();
+			}
+
+			return n;
+		}
+	};
+
+	ReadAhead::ReadAhead(ReadCallback& source, std::size_t block_size)
+		: pipeline(new Pipeline(source, block_size))
+	{
+	}
+
+	ReadAhead::~ReadAhead() = default;
+
+	std::size_t ReadAhead::read(char* buffer, std::size_t size)
+	{
+		return pipeline->read(buffer, size);
+	}
+
+	// reads at explicit offsets where the file is seekable, so that nothing else can move it
+	class ReadAheadFile::Source : public ReadCallback
+	{
+		File file;
+		bool seekable;
+		std::uint64_t position = 0;
+
+	public:
+		explicit Source(const std::filesystem::path& path)
+			: file(path), seekable(file.mappableSize() != 0)
+		{
+			file.adviseSequential();
+		}
+
+		std::size_t read(char* buffer, std::size_t size) override
+		{
+			auto n = file.read(buffer, size, position, seekable);
+
+			if (n < 0)
+				throw std::runtime_error("failed to read obj file");
+
+			position += static_cast<std::size_t>(n);
+			return static_cast<std::size_t>(n);
+		}
+	};
+
+	ReadAheadFile::ReadAheadFile(const std::filesystem::path& path, std::size_t block_size)
+		: source(new Source(path)), input(*source, block_size)
+	{
+	}
+
+	ReadAheadFile::~ReadAheadFile() = default;
+
+	std::size_t ReadAheadFile::read(char* buffer, std::size_t size)
+	{
+		return input.read(buffer, size);
+	}
+}
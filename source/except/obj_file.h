@@ -0,0 +1,104 @@
+#ifndef INCLUDED_OBJ_FILE
+#define INCLUDED_OBJ_FILE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <chrono>
+#include <filesystem>
+
+#include "obj_gzip.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	// the contents of a file, mapped into memory so that parsing can start before all of it has been read, or copied
+	// into a buffer if access is READ or the file cannot be mapped, like pipes and other files that are not regular
+	class InputFile
+	{
+		std::unique_ptr<char[]> buffer;
+		const char* data = nullptr;
+		std::size_t size = 0;
+		bool mapped = false;
+
+	public:
+		InputFile(const std::filesystem::path& path, FileAccess access);
+		~InputFile();
+
+		InputFile(const InputFile&) = delete;
+		InputFile& operator =(const InputFile&) = delete;
+
+		const char* begin() const { return data; }
+		const char* end() const { return data + size; }
+
+		bool compressed() const { return isGzip(begin(), end()); }
+	};
+
+	// the part of a file from offset to its end, copied into memory, for following files that grow
+	class FileTail
+	{
+		std::unique_ptr<char[]> buffer;
+		std::size_t size = 0;
+		std::uint64_t file_id;
+		std::uint64_t file_size;
+
+	public:
+		// reads nothing if the file has become shorter than offset
+		FileTail(const std::filesystem::path& path, std::uint64_t offset);
+
+		const char* begin() const { return &buffer[0]; }
+		const char* end() const { return &buffer[0] + size; }
+
+		// tells the file apart from another one that has been saved under its name since
+		std::uint64_t fileId() const { return file_id; }
+		std::uint64_t fileSize() const { return file_size; }
+	};
+
+	// waits for a file to change; it is followed by name, so saving another file over it is a change as well. Uses
+	// inotify on Linux, elsewhere it checks the size and the time of the last change of the file every so often
+	class FileWatch
+	{
+		class Watch;
+		std::unique_ptr<Watch> watch;
+
+	public:
+		explicit FileWatch(const std::filesystem::path& path);
+		~FileWatch();
+
+		// returns false if the file has not changed within timeout
+		bool wait(std::chrono::milliseconds timeout);
+	};
+
+	// reads source on a thread of its own, a few blocks ahead of the ones that are handed to readTriangles, so that
+	// waiting for the input and parsing it overlap; input that is gzip compressed is inflated on that thread as well
+	class ReadAhead : public ReadCallback
+	{
+		class Pipeline;
+		std::unique_ptr<Pipeline> pipeline;
+
+	public:
+		ReadAhead(ReadCallback& source, std::size_t block_size);
+		~ReadAhead();
+
+		std::size_t read(char* buffer, std::size_t size) override;
+	};
+
+	// a file that is read ahead, see ReadAhead
+	class ReadAheadFile : public ReadCallback
+	{
+		class Source;
+		std::unique_ptr<Source> source;
+		ReadAhead input;
+
+	public:
+		ReadAheadFile(const std::filesystem::path& path, std::size_t block_size);
+		~ReadAheadFile();
+
+		std::size_t read(char* buffer, std::size_t size) override;
+	};
+}
+
+#endif  // INCLUDED_OBJ_FILE
@@ -0,0 +1,149 @@
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(OBJ_ZLIB)
+#include <zlib.h>
+#endif
+
+#include "obj_gzip.h"
+
+
+namespace
+{
+	constexpr std::size_t INPUT_BUFFER_SIZE = 1 << 16;
+}
+
+namespace OBJ
+{
+	bool isGzip(const char* begin, const char* end)
+	{
+		return end - begin >= 2 && static_cast<unsigned char>(begin[0]) == 0x1F && static_cast<unsigned char>(begin[1]) == 0x8B;
+	}
+
+#if defined(OBJ_ZLIB)
+	struct GzipReadCallback::Inflater
+	{
+		z_stream stream = {};
+		bool in_member = false;  // a member has been started and not finished yet
+
+		Inflater()
+		{
+			// 16 selects the gzip wrapper
+			if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+				throw std::runtime_error("failed to decompress obj file");
+		}
+
+		~Inflater()
+		{
+			inflateEnd(&stream);
+		}
+	};
+#else
+	struct GzipReadCallback::Inflater
+	{
+		Inflater()
+		{
+			throw std::runtime_error("compressed obj files are not supported by this build");
+		}
+	};
+#endif
+
+	GzipReadCallback::GzipReadCallback(ReadCallback& source)
+		: source(source)
+	{
+	}
+
+	GzipReadCallback::~GzipReadCallback() = default;
+
+	// reads the next chunk of source, returns false at its end
+	bool GzipReadCallback::fillInput()
+	{
+		if (!input)
+			input.reset(new char[INPUT_BUFFER_SIZE]);
+
+		num_pending = source.read(&input[0], INPUT_BUFFER_SIZE);
+		pending = &input[0];
+		source_end = num_pending == 0;
+		return !source_end;
+	}
+
+	void GzipReadCallback::detectFormat()
+	{
+		// the first read may be short of the two bytes that tell
+		if (fillInput() && num_pending == 1)
+			num_pending += source.read(&input[1], 1);
+
+		if (isGzip(pending, pending + num_pending))
+		{
+			inflater.reset(new Inflater());
+			format = Format::GZIP;
+		}
+		else
+			format = Format::PLAIN;
+	}
+
+	std::size_t GzipReadCallback::inflate(char* buffer, std::size_t size)
+	{
+#if defined(OBJ_ZLIB)
+		auto& stream = inflater->stream;
+
+		stream.next_out = reinterpret_cast<Bytef*>(buffer);
+		stream.avail_out = static_cast<uInt>(std::min<std::size_t>(size, UINT_MAX));
+		auto capacity = stream.avail_out;
+
+		while (stream.avail_out == capacity)
+		{
+			if (num_pending == 0 && !fillInput())
+			{
+				if (inflater->in_member)
+					throw std::runtime_error("compressed obj file is truncated");
+				return 0;
+			}
+
+			stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pending));
+			stream.avail_in = static_cast<uInt>(num_pending);
+			inflater->in_member = true;
+
+			int ret = ::inflate(&stream, Z_NO_FLUSH);
+
+			pending = reinterpret_cast<const char*>(stream.next_in);
+			num_pending = stream.avail_in;
+
+			if (ret == Z_STREAM_END)
+			{
+				// another member may follow
+				inflateReset(&stream);
+				inflater->in_member = false;
+			}
+			else if (ret != Z_OK && ret != Z_BUF_ERROR)
+				throw std::runtime_error("failed to decompress obj file");
+		}
+
+		return capacity - stream.avail_out;
+#else
+		return 0;
+#endif
+	}
+
+	std::size_t GzipReadCallback::read(char* buffer, std::size_t size)
+	{
+		if (format == Format::UNKNOWN)
+			detectFormat();
+
+		if (format == Format::GZIP)
+			return inflate(buffer, size);
+
+		if (num_pending != 0)
+		{
+			auto n = std::min(size, num_pending);
+			std::memcpy(buffer, pending, n);
+			pending += n;
+			num_pending -= n;
+			return n;
+		}
+
+		return source_end ? 0 : source.read(buffer, size);
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef INCLUDED_OBJ_GZIP
+#define INCLUDED_OBJ_GZIP
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "obj.h"
+
+
+namespace OBJ
+{
+	// tells whether the input starts like a gzip file
+	bool isGzip(const char* begin, const char* end);
+
+	// reads what source reads, inflated if it turns out to be gzip compressed; files made of several gzip members, as
+	// concatenating .gz files produces, are read as one. Needs zlib, builds without it fail on compressed input
+	class GzipReadCallback : public ReadCallback
+	{
+		enum class Format
+		{
+			UNKNOWN,
+			PLAIN,
+			GZIP
+		};
+
+		struct Inflater;
+
+		ReadCallback& source;
+		Format format = Format::UNKNOWN;
+		std::unique_ptr<char[]> input;
+		const char* pending = nullptr;  // input that has been read from source, but not passed on yet
+		std::size_t num_pending = 0;
+		bool source_end = false;
+		std::unique_ptr<Inflater> inflater;
+
+		bool fillInput();
+		void detectFormat();
+		std::size_t inflate(char* buffer, std::size_t size);
+
+	public:
+		explicit GzipReadCallback(ReadCallback& source);
+		~GzipReadCallback();
+
+		GzipReadCallback(const GzipReadCallback&) = delete;
+		GzipReadCallback& operator =(const GzipReadCallback&) = delete;
+
+		std::size_t read(char* buffer, std::size_t size) override;
+	};
+}
+
+#endif  // INCLUDED_OBJ_GZIP
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+#include <parse/kernels.h>
+
+#include "obj_stream.h"
+#include "obj_reader.h"
+#include "obj_indexed_reader.h"
+#include "obj_gzip.h"
+#include "obj_incremental.h"
+
+
+namespace
+{
+	// how much of the end of the lines that have been parsed is compared to tell whether the file still has them
+	constexpr std::size_t PARSED_END_SIZE = 1 << 12;
+
+	// a Stream over lines that do not start at the top of the file
+	class TailStream : public OBJ::Stream
+	{
+	public:
+		TailStream(const char* begin, const char* end, std::string_view name, OBJ::StreamCallback& callback, int first_line)
+			: OBJ::Stream(begin, end, name, callback)
+		{
+			line = first_line;
+		}
+	};
+
+	// the end of the last complete line in [begin, end)
+	const char* lastLineEnd(const char* begin, const char* end)
+	{
+		auto p = std::find(std::make_reverse_iterator(end), std::make_reverse_iterator(begin), '\n');
+		return p.base();
+	}
+}
+
+namespace OBJ
+{
+	IncrementalOBJ::IncrementalOBJ(const std::filesystem::path& path, StreamCallback& stream_callback, const ReadOptions& options)
+		: path(path), name(path.filename().u8string()), stream_callback(stream_callback), options(options), watch(path)
+	{
+		reload();
+	}
+
+	IncrementalOBJ::~IncrementalOBJ() = default;
+
+	void IncrementalOBJ::parse(const char* begin, const char* end)
+	{
+		TailStream stream(begin, end, name, stream_callback, line);
+
+		stale = true;
+
+		if (options.engine == Engine::INDEXED)
+		{
+			IndexedReader<detail::IncrementalConsumer> reader(*consumer);
+			stream.consume(reader);
+		}
+		else
+		{
+			Reader<detail::IncrementalConsumer> reader(*consumer);
+			stream.consume(reader);
+		}
+
+		// the faces at the end would otherwise wait for the next batch to be merged
+		consumer->mergeFaces();
+
+		stale = false;
+
+		line += static_cast<std::int64_t>(parse::activeKernels().countNewlines(begin, end));
+		parsed += static_cast<std::uint64_t>(end - begin);
+
+		if (static_cast<std::size_t>(end - begin) >= PARSED_END_SIZE)
+			parsed_end.assign(end - PARSED_END_SIZE, end);
+		else
+		{
+			parsed_end.append(begin, end);
+
+			if (parsed_end.size() > PARSED_END_SIZE)
+				parsed_end.erase(0, parsed_end.size() - PARSED_END_SIZE);
+		}
+	}
+
+	void IncrementalOBJ::reload()
+	{
+		FileTail file(path, 0);
+
+		if (isGzip(file.begin(), file.end()))
+			throw std::runtime_error("compressed obj files cannot be read incrementally");
+
+		consumer.reset(new detail::IncrementalConsumer(options.hash_seed));
+		file_id = file.fileId();
+		parsed = 0;
+		line = 1;
+		parsed_end.clear();
+
+		parse(file.begin(), lastLineEnd(file.begin(), file.end()));
+	}
+
+	IncrementalOBJ::Change IncrementalOBJ::update()
+	{
+		if (stale)
+		{
+			reload();
+			return Change::RELOADED;
+		}
+
+		// the end of what has been parsed is read again along with what comes after it
+		FileTail tail(path, parsed - parsed_end.size());
+
+		if (tail.fileId() != file_id || tail.fileSize() < parsed || std::string_view(tail.begin(), parsed_end.size()) != parsed_end)
+		{
+			reload();
+			return Change::RELOADED;
+		}
+
+		auto begin = tail.begin() + parsed_end.size();
+		auto end = lastLineEnd(begin, tail.end());
+
+		if (begin == end)
+			return Change::NONE;
+
+		parse(begin, end);
+		return Change::APPENDED;
+	}
+
+	bool IncrementalOBJ::waitForChange(std::chrono::milliseconds timeout)
+	{
+		return watch.wait(timeout);
+	}
+}
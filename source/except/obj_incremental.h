@@ -0,0 +1,88 @@
+#ifndef INCLUDED_OBJ_INCREMENTAL
+#define INCLUDED_OBJ_INCREMENTAL
+
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <filesystem>
+
+#include "obj_consumer.h"
+#include "obj_file.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	namespace detail
+	{
+		// an OBJConsumer whose triangles can be looked at while it goes on taking statements
+		class IncrementalConsumer : public OBJConsumer
+		{
+		public:
+			using OBJConsumer::OBJConsumer;
+
+			const std::vector<float3>& positionList() const { return positions; }
+			const std::vector<float3>& normalList() const { return normals; }
+			const std::vector<float2>& texcoordList() const { return texcoords; }
+			const std::vector<std::array<int, 3>>& triangleList() const { return triangles; }
+		};
+	}
+
+	// the triangles of an OBJ file that is appended to or saved again while it is being looked at: update only parses
+	// the lines that were appended since the last time, on top of what the ones before left in the consumer; if the file
+	// was replaced or the end of what was parsed before has changed, it is read again from the start. Only complete lines
+	// are parsed, a last line without a newline waits until it has one. Compressed files are not supported
+	class IncrementalOBJ
+	{
+	public:
+		enum class Change
+		{
+			NONE,
+			APPENDED,
+			RELOADED
+		};
+
+	private:
+		std::filesystem::path path;
+		std::string name;
+		StreamCallback& stream_callback;
+		ReadOptions options;
+		FileWatch watch;
+
+		std::unique_ptr<detail::IncrementalConsumer> consumer;
+		std::uint64_t file_id = 0;
+		std::uint64_t parsed = 0;  // the lines at the start of the file that are in the consumer
+		std::int64_t line = 1;     // the line that parsed ends before
+		std::string parsed_end;    // the last bytes of those lines, to tell whether the file still has them
+		bool stale = false;        // parsing stopped at an error, partway through the lines it was given
+
+		void parse(const char* begin, const char* end);
+		void reload();
+
+	public:
+		// reads the file for the first time, on a single thread
+		IncrementalOBJ(const std::filesystem::path& path, StreamCallback& stream_callback, const ReadOptions& options = {});
+		~IncrementalOBJ();
+
+		IncrementalOBJ(const IncrementalOBJ&) = delete;
+		IncrementalOBJ& operator =(const IncrementalOBJ&) = delete;
+
+		// catches up with the file
+		Change update();
+
+		// returns false if the file has not changed within timeout, update tells how
+		bool waitForChange(std::chrono::milliseconds timeout);
+
+		const std::vector<float3>& positions() const { return consumer->positionList(); }
+		const std::vector<float3>& normals() const { return consumer->normalList(); }
+		const std::vector<float2>& texcoords() const { return consumer->texcoordList(); }
+		const std::vector<std::array<int, 3>>& triangles() const { return consumer->triangleList(); }
+	};
+}
+
+#endif  // INCLUDED_OBJ_INCREMENTAL
@@ -0,0 +1,313 @@
+#ifndef INCLUDED_OBJ_LAZY
+#define INCLUDED_OBJ_LAZY
+
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include <parse/scan.h>
+#include <parse/kernels.h>
+
+#include "hash_map.h"
+#include "obj_stream.h"
+#include "obj_reader.h"
+#include "obj_consumer.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	namespace detail
+	{
+		// parses the statements that LazyOBJ hands to it one at a time, keeping what the last one produced
+		class LazyStatementConsumer : public OBJConsumer
+		{
+			using OBJConsumer::checkFaceVertexCount;
+			using OBJConsumer::checkFaceSize;
+
+		public:
+			using OBJConsumer::MAX_FACE_VERTICES;
+
+			std::vector<face_vertex_t> face;
+			std::string_view object_name;
+
+			// forgets about a statement that failed halfway
+			void reset()
+			{
+				face.clear();
+				num_face_vertices = 0;
+			}
+
+			template <typename Stream>
+			void consumeFaceVertex(Stream& stream, int vi, int ni, int ti)
+			{
+				checkFaceVertexCount(stream, num_face_vertices);
+				face.push_back({ vi, ni, ti });
+				++num_face_vertices;
+			}
+
+			template <typename Stream>
+			void consumeFaceVertices(Stream& stream, const face_vertex_t* vertices, int count)
+			{
+				for (int i = 0; i < count; ++i)
+					consumeFaceVertex(stream, vertices[i].v, vertices[i].n, vertices[i].t);
+			}
+
+			template <typename Stream>
+			void finishFace(Stream& stream)
+			{
+				checkFaceSize(stream, num_face_vertices);
+				num_face_vertices = 0;
+			}
+
+			template <typename Stream>
+			void consumeObjectName(Stream& stream, std::string_view name)
+			{
+				object_name = name;
+			}
+
+			float3 takeVertex()
+			{
+				auto p = v.back();
+				v.clear();
+				return p;
+			}
+
+			float3 takeNormal()
+			{
+				auto n = vn.back();
+				vn.pop_back();
+				return n;
+			}
+
+			float2 takeTexcoord()
+			{
+				auto t = vt.back();
+				vt.pop_back();
+				return t;
+			}
+		};
+	}
+
+	// reads an OBJ file on demand: constructing it only finds the lines of the v, vn, vt and f statements, vertex
+	// attributes are converted the first time they are asked for and faces whenever their triangles are; the few other
+	// statements are read right away. The text has to outlive the LazyOBJ, diagnostics are the same as readTriangles'
+	class LazyOBJ
+	{
+	public:
+		struct Object
+		{
+			std::string_view name;
+			std::size_t first_face;
+			std::size_t num_faces;
+		};
+
+	private:
+		template <typename T>
+		struct lazy_attribute
+		{
+			std::vector<const char*> lines;
+			std::vector<T> values;
+			std::vector<bool> converted;
+
+			void finishIndex()
+			{
+				values.resize(size(lines));
+				converted.resize(size(lines));
+			}
+
+			// the number of these attributes that come before the statement at line
+			int countBefore(const char* line) const
+			{
+				return static_cast<int>(std::lower_bound(begin(lines), end(lines), line) - begin(lines));
+			}
+		};
+
+		const char* text_begin;
+		const char* text_end;
+		std::string_view name;
+		StreamCallback& stream_callback;
+
+		detail::LazyStatementConsumer consumer;
+		Reader<detail::LazyStatementConsumer> reader;
+
+		lazy_attribute<float3> vertices;
+		lazy_attribute<float3> normals;
+		lazy_attribute<float2> texcoords;
+		std::vector<const char*> faces;
+		std::vector<Object> object_list;
+
+		// parses the statement that starts at line with a stream over the whole text, so that diagnostics have the right line numbers
+		Stream parseStatement(const char* line)
+		{
+			Stream stream(text_begin, text_end, name, stream_callback);
+			consumer.reset();
+			stream.advance(line + 1);
+			reader.consume(stream, *line);
+			reader.finish(stream);
+			return stream;
+		}
+
+		template <typename T, typename Take>
+		const T& get(lazy_attribute<T>& attribute, std::size_t i, Take&& take)
+		{
+			if (!attribute.converted[i])
+			{
+				parseStatement(attribute.lines[i]);
+				attribute.values[i] = take();
+				attribute.converted[i] = true;
+			}
+
+			return attribute.values[i];
+		}
+
+	public:
+		LazyOBJ(const char* begin, const char* end, std::string_view name, StreamCallback& stream_callback)
+			: text_begin(begin), text_end(end), name(name), stream_callback(stream_callback), reader(consumer)
+		{
+			for (const char* p = parse::scan::findFirstNotOf<' ', '\t', '\r', '\n'>(begin, end); p != end; p = parse::scan::findFirstNotOf<' ', '\t', '\r', '\n'>(p, end))
+			{
+				const char* command_end = parse::scan::findFirstOf<' ', '\t', '\r', '\n', '\v', '\f'>(p, end);
+				std::string_view command(p, command_end - p);
+
+				if (command == "v"sv)
+					vertices.lines.push_back(p);
+				else if (command == "vn"sv)
+					normals.lines.push_back(p);
+				else if (command == "vt"sv)
+					texcoords.lines.push_back(p);
+				else if (command == "f"sv)
+					faces.push_back(p);
+				else if (command.empty() || command[0] != '#')
+				{
+					p = parseStatement(p).position();
+
+					if (!consumer.object_name.empty())
+					{
+						if (!object_list.empty())
+							object_list.back().num_faces = size(faces) - object_list.back().first_face;
+
+						object_list.push_back({ consumer.object_name, size(faces), 0 });
+						consumer.object_name = {};
+					}
+
+					continue;
+				}
+
+				p = parse::activeKernels().findNewline(command_end, end);
+			}
+
+			if (!object_list.empty())
+				object_list.back().num_faces = size(faces) - object_list.back().first_face;
+
+			vertices.finishIndex();
+			normals.finishIndex();
+			texcoords.finishIndex();
+		}
+
+		std::size_t numVertices() const
+		{
+			return size(vertices.lines);
+		}
+
+		std::size_t numNormals() const
+		{
+			return size(normals.lines);
+		}
+
+		std::size_t numTexcoords() const
+		{
+			return size(texcoords.lines);
+		}
+
+		std::size_t numFaces() const
+		{
+			return size(faces);
+		}
+
+		// the o statements of the file, with the faces that follow each of them
+		const std::vector<Object>& objects() const
+		{
+			return object_list;
+		}
+
+		// the attributes of the i-th v, vn and vt statements, converted the first time they are asked for
+		const float3& vertex(std::size_t i)
+		{
+			return get(vertices, i, [&] { return consumer.takeVertex(); });
+		}
+
+		const float3& normal(std::size_t i)
+		{
+			return get(normals, i, [&] { return consumer.takeNormal(); });
+		}
+
+		const float2& texcoord(std::size_t i)
+		{
+			return get(texcoords, i, [&] { return consumer.takeTexcoord(); });
+		}
+
+		// the triangles of every face_stride-th face of [first_face, first_face + num_faces), with the face vertices shared among them merged
+		Triangles triangles(std::size_t first_face, std::size_t num_faces, std::size_t face_stride = 1)
+		{
+			Triangles out;
+			hash_map<vertex_key<Attributes::ALL>, int, vertex_key_hash> vertex_map;
+
+			for (std::size_t f = first_face; f < first_face + num_faces; f += face_stride)
+			{
+				const char* line = faces[f];
+				auto stream = parseStatement(line);
+				stream.advance(line);
+
+				// relative indices count back from the attributes that come before the face in the file
+				int num_v = vertices.countBefore(line);
+				int num_vn = normals.countBefore(line);
+				int num_vt = texcoords.countBefore(line);
+
+				// looking up the attributes parses their statements, which starts over with the consumer's face
+				face_vertex_t corners[detail::LazyStatementConsumer::MAX_FACE_VERTICES];
+				int face_vertices[detail::LazyStatementConsumer::MAX_FACE_VERTICES];
+				int num_face_vertices = static_cast<int>(size(consumer.face));
+				std::copy(begin(consumer.face), end(consumer.face), corners);
+
+				for (int i = 0; i < num_face_vertices; ++i)
+				{
+					auto [vi, ni, ti] = corners[i];
+
+					vi = vi < 0 ? num_v + vi : vi - 1;
+					ni = ni < 0 ? num_vn + ni : ni - 1;
+					ti = ti < 0 ? num_vt + ti : ti - 1;
+
+					if (vi < 0 || vi >= num_v || ni < -1 || ni >= num_vn || ti < -1 || ti >= num_vt)
+						stream.throwError("face vertex index out of range"sv);
+
+					auto [fv, inserted] = vertex_map.try_emplace(vertex_key<Attributes::ALL>::make(vi, ni, ti), static_cast<int>(size(out.positions)));
+
+					if (inserted)
+					{
+						out.positions.push_back(vertex(vi));
+						out.normals.push_back(ni < 0 ? float3 { 0.0f, 0.0f, 0.0f } : normal(ni));
+						out.texcoords.push_back(ti < 0 ? float2 { 0.0f, 0.0f } : texcoord(ti));
+					}
+
+					face_vertices[i] = fv->second;
+				}
+
+				for (int i = 2; i < num_face_vertices; ++i)
+					out.triangles.push_back({ face_vertices[0], face_vertices[i - 1], face_vertices[i] });
+			}
+
+			return out;
+		}
+
+		Triangles triangles(const Object& object)
+		{
+			return triangles(object.first_face, object.num_faces);
+		}
+	};
+}
+
+#endif  // INCLUDED_OBJ_LAZY
@@ -0,0 +1,281 @@
+#include <utility>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <exception>
+#include <system_error>
+#include <vector>
+#include <thread>
+
+#include "obj_stream.h"
+#include "obj_reader.h"
+#include "obj_indexed_reader.h"
+#include "obj_consumer.h"
+#include "obj_parallel.h"
+
+using namespace std::literals;
+
+
+namespace
+{
+	constexpr std::ptrdiff_t MIN_CHUNK_SIZE = 1 << 20;
+
+	struct Diagnostic
+	{
+		bool is_error;
+		std::int64_t line;
+		std::string_view msg;
+	};
+
+	// buffers the diagnostics of one chunk so they can be replayed in file order once all chunks are done
+	struct DiagnosticRecorder
+	{
+		std::vector<Diagnostic> diagnostics;
+
+		void progress(float progress)
+		{
+		}
+
+		void warning(std::string_view file, std::int64_t line, std::string_view msg)
+		{
+			diagnostics.push_back({ false, line, msg });
+		}
+
+		void error(std::string_view file, std::int64_t line, std::string_view msg)
+		{
+			diagnostics.push_back({ true, line, msg });
+		}
+
+		void finish()
+		{
+		}
+	};
+
+	using ChunkStream = OBJ::BasicStream<DiagnosticRecorder>;
+
+
+	// collects vertex attributes like an OBJConsumer but only records the face vertices of its chunk,
+	// since deduplication has to see the faces of all chunks in file order
+	template <OBJ::Attributes A, typename Index>
+	class ChunkConsumer : public OBJ::BasicOBJConsumer<A, Index>
+	{
+		using base = OBJ::BasicOBJConsumer<A, Index>;
+		using base::v;
+		using base::vn;
+		using base::vt;
+		using base::num_face_vertices;
+		using base::checkFaceVertexCount;
+		using base::checkFaceSize;
+
+		std::vector<OBJ::basic_face_vertex<Index>> corners;
+		std::vector<std::uint8_t> face_sizes;
+
+		// relative indices refer to attributes from before the face and possibly from previous chunks;
+		// they are recorded relative to the start of the chunk until the chunk's attribute counts are known
+		std::vector<std::size_t> relative_indices[3];
+
+		Index resolveLocal(Index i, Index num_attributes, int component)
+		{
+			if (i >= 0)
+				return i;
+			relative_indices[component].push_back(size(corners));
+			return num_attributes + i;
+		}
+
+	public:
+		void consumeFaceVertex(ChunkStream& stream, Index vi, Index ni, Index ti)
+		{
+			checkFaceVertexCount(stream, num_face_vertices);
+
+			vi = resolveLocal(vi, static_cast<Index>(size(v)), 0);
+			ni = resolveLocal(ni, static_cast<Index>(size(vn)) - 1, 1);
+			ti = resolveLocal(ti, static_cast<Index>(size(vt)) - 1, 2);
+
+			corners.push_back({ vi, ni, ti });
+			++num_face_vertices;
+		}
+
+		void consumeFaceVertices(ChunkStream& stream, const OBJ::basic_face_vertex<Index>* vertices, int count)
+		{
+			for (int i = 0; i < count; ++i)
+				consumeFaceVertex(stream, vertices[i].v, vertices[i].n, vertices[i].t);
+		}
+
+		void finishFace(ChunkStream& stream)
+		{
+			checkFaceSize(stream, num_face_vertices);
+			face_sizes.push_back(static_cast<std::uint8_t>(num_face_vertices));
+			num_face_vertices = 0;
+		}
+
+		void finishChunk()
+		{
+			// turn chunk-relative indices back into indices relative to the end of the chunk,
+			// which is where the attribute counts will be when the faces are replayed
+			for (auto i : relative_indices[0])
+				corners[i].v -= static_cast<Index>(size(v));
+			for (auto i : relative_indices[1])
+				corners[i].n -= static_cast<Index>(size(vn)) - 1;
+			for (auto i : relative_indices[2])
+				corners[i].t -= static_cast<Index>(size(vt)) - 1;
+		}
+
+		std::size_t numVertices() const
+		{
+			return size(v);
+		}
+
+		void replay(OBJ::BasicOBJConsumer<A, Index>& consumer, OBJ::Stream& stream)
+		{
+			consumer.appendAttributes(std::move(*this));
+
+			const OBJ::basic_face_vertex<Index>* corner = data(corners);
+			for (int num_vertices : face_sizes)
+			{
+				consumer.consumeFaceVertices(stream, corner, num_vertices);
+				consumer.finishFace(stream);
+				corner += num_vertices;
+			}
+		}
+	};
+
+
+	template <OBJ::Attributes A, typename Index>
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+		DiagnosticRecorder diagnostics;
+		ChunkConsumer<A, Index> consumer;
+		std::int64_t num_lines = 0;
+		std::exception_ptr exception;
+	};
+
+	template <typename Reader, OBJ::Attributes A, typename Index>
+	void parseChunk(Chunk<A, Index>& chunk, std::string_view name)
+	{
+		try
+		{
+			ChunkStream stream(chunk.begin, chunk.end, name, chunk.diagnostics);
+			Reader reader(chunk.consumer);
+			stream.consume(reader);
+			chunk.consumer.finishChunk();
+			chunk.num_lines = stream.lineNumber() - 1;
+		}
+		catch (...)
+		{
+			chunk.exception = std::current_exception();
+		}
+	}
+
+	template <OBJ::Attributes A, typename Index>
+	std::vector<Chunk<A, Index>> splitChunks(const char* begin, const char* end, int num_chunks)
+	{
+		std::vector<Chunk<A, Index>> chunks(num_chunks);
+
+		auto size = end - begin;
+		const char* chunk_begin = begin;
+
+		for (int i = 0; i < num_chunks; ++i)
+		{
+			const char* chunk_end = std::max(begin + size * (i + 1) / num_chunks, chunk_begin);
+
+			if (chunk_end != end)
+			{
+				auto newline = static_cast<const char*>(std::memchr(chunk_end, '\n', end - chunk_end));
+				chunk_end = newline ? newline + 1 : end;
+			}
+
+			chunks[i].begin = chunk_begin;
+			chunks[i].end = chunk_end;
+			chunk_begin = chunk_end;
+		}
+
+		return chunks;
+	}
+}
+
+namespace OBJ
+{
+	int parallelChunkCount(std::ptrdiff_t size, int num_threads)
+	{
+		if (num_threads <= 0)
+			num_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+		return static_cast<int>(std::min<std::ptrdiff_t>(num_threads, size / MIN_CHUNK_SIZE + 1));
+	}
+
+	template <Attributes A, typename Index>
+	BasicTriangles<A, Index> readTrianglesParallel(const char* begin, const char* end, std::string_view name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options)
+	{
+		auto chunks = splitChunks<A, Index>(begin, end, num_chunks);
+		auto parseChunk = options.engine == Engine::INDEXED ? ::parseChunk<IndexedReader<ChunkConsumer<A, Index>, ChunkStream>, A, Index> : ::parseChunk<Reader<ChunkConsumer<A, Index>, ChunkStream>, A, Index>;
+
+		{
+			std::vector<std::thread> workers;
+			workers.reserve(num_chunks - 1);
+
+			int next_chunk = 1;
+			try
+			{
+				for (; next_chunk < num_chunks; ++next_chunk)
+					workers.emplace_back(parseChunk, std::ref(chunks[next_chunk]), name);
+			}
+			catch (const std::system_error&)
+			{
+				// out of threads, parse whatever is left on this one
+			}
+
+			parseChunk(chunks[0], name);
+
+			for (; next_chunk < num_chunks; ++next_chunk)
+				parseChunk(chunks[next_chunk], name);
+
+			for (auto& worker : workers)
+				worker.join();
+		}
+
+		BasicOBJConsumer<A, Index> consumer(options.hash_seed);
+		Stream stream(end, end, name, stream_callback);
+
+		// faces mostly share their positions, which makes there about as many output vertices as positions
+		std::size_t num_vertices = 0;
+		for (int i = 0; i < num_chunks; ++i)
+			num_vertices += chunks[i].consumer.numVertices();
+		consumer.reserveVertices(num_vertices);
+
+		std::int64_t line_offset = 0;
+		for (int i = 0; i < num_chunks; ++i)
+		{
+			auto& chunk = chunks[i];
+
+			for (const auto& d : chunk.diagnostics.diagnostics)
+			{
+				if (d.is_error)
+					stream_callback.error(name, line_offset + d.line, d.msg);
+				else
+					stream_callback.warning(name, line_offset + d.line, d.msg);
+			}
+
+			if (chunk.exception)
+				std::rethrow_exception(chunk.exception);
+
+			chunk.consumer.replay(consumer, stream);
+			line_offset += chunk.num_lines;
+
+			stream_callback.progress(static_cast<float>(i + 1) / num_chunks);
+		}
+
+		stream_callback.finish();
+		return consumer.finish();
+	}
+
+	template BasicTriangles<Attributes::POSITIONS> readTrianglesParallel<Attributes::POSITIONS>(const char* begin, const char* end, std::string_view name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options);
+	template BasicTriangles<Attributes::NORMALS> readTrianglesParallel<Attributes::NORMALS>(const char* begin, const char* end, std::string_view name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options);
+	template BasicTriangles<Attributes::TEXCOORDS> readTrianglesParallel<Attributes::TEXCOORDS>(const char* begin, const char* end, std::string_view name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options);
+	template BasicTriangles<Attributes::ALL> readTrianglesParallel<Attributes::ALL>(const char* begin, const char* end, std::string_view name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options);
+	template BasicTriangles<Attributes::POSITIONS, std::int64_t> readTrianglesParallel<Attributes::POSITIONS, std::int64_t>(const char* begin, const char* end, std::string_view name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options);
+	template BasicTriangles<Attributes::NORMALS, std::int64_t> readTrianglesParallel<Attributes::NORMALS, std::int64_t>(const char* begin, const char* end, std::string_view name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options);
+	template BasicTriangles<Attributes::TEXCOORDS, std::int64_t> readTrianglesParallel<Attributes::TEXCOORDS, std::int64_t>(const char* begin, const char* end, std::string_view name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options);
+	template BasicTriangles<Attributes::ALL, std::int64_t> readTrianglesParallel<Attributes::ALL, std::int64_t>(const char* begin, const char* end, std::string_view name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options);
+}
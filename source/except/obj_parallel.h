@@ -0,0 +1,22 @@
+#ifndef INCLUDED_OBJ_PARALLEL
+#define INCLUDED_OBJ_PARALLEL
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "obj.h"
+
+
+namespace OBJ
+{
+	int parallelChunkCount(std::ptrdiff_t size, int num_threads);
+
+	// instantiated for every combination of Attributes, with int and std::int64_t indices, in obj_parallel.cpp
+	template <Attributes A, typename Index = int>
+	BasicTriangles<A, Index> readTrianglesParallel(const char* begin, const char* end, std::string_view name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options);
+}
+
+#endif  // INCLUDED_OBJ_PARALLEL
@@ -3,17 +3,60 @@
 
 #pragma once
 
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+
+#include <parse/keyword_table.h>
+
 #include "obj_stream.h"
+#include "obj_batch.h"
 
 
 namespace OBJ
 {
+	// the vertex attributes a consumer reads, all of them unless it declares a static constexpr Attributes attributes member
+	template <typename Consumer, typename = void>
+	struct consumer_attributes : std::integral_constant<Attributes, Attributes::ALL>
+	{
+	};
+
 	template <typename Consumer>
+	struct consumer_attributes<Consumer, std::void_t<decltype(Consumer::attributes)>> : std::integral_constant<Attributes, Consumer::attributes>
+	{
+	};
+
+	template <typename Consumer, typename Stream = OBJ::Stream>
 	class Reader
 	{
+		static constexpr Attributes attributes = consumer_attributes<Consumer>::value;
+		static constexpr bool batched = accepts_batches<Consumer, Stream>::value;
+
+		using index_type = consumer_index_t<Consumer>;
+
+		struct unbatched
+		{
+		};
+
+		template <typename T>
+		using batch_t = std::conditional_t<batched, batch<T>, unbatched>;
+
 		Consumer& consumer;
+		std::optional<parse::FaceFormat> face_format;
+
+		batch_t<float3> vertices;
+		batch_t<float3> normals;
+		batch_t<float2> texcoords;
+		batch_t<basic_face_vertex<index_type>> face_vertices;
 
-		void consumeVertex(OBJ::Stream& stream)
+		struct command
+		{
+			void (Reader::*consume)(Stream& stream);
+			bool attribute = false;  // batched attributes are flushed before any other statement
+			bool ignore_without_arguments = false;
+		};
+
+		void consumeVertex(Stream& stream)
 		{
 			float x = stream.expectFloat();
 			stream.expectHorizontalWS();
@@ -24,15 +67,15 @@ namespace OBJ
 			if (float w; stream.consumeHorizontalWS() && stream.consumeFloat(w))
 			{
 				stream.expectLineEnd();
-				consumer.consumeVertex(stream, x, y, z, w);
+				emitVertex(stream, x, y, z, w);
 				return;
 			}
 
 			stream.expectLineEnd();
-			consumer.consumeVertex(stream, x, y, z);
+			emitVertex(stream, x, y, z);
 		}
 
-		void consumeNormal(OBJ::Stream& stream)
+		void consumeNormal(Stream& stream)
 		{
 			float x = stream.expectFloat();
 			stream.expectHorizontalWS();
@@ -41,10 +84,10 @@ namespace OBJ
 			float z = stream.expectFloat();
 			stream.expectLineEnd();
 
-			consumer.consumeNormal(stream, x, y, z);
+			emitNormal(stream, x, y, z);
 		}
 
-		void consumeTexcoord(OBJ::Stream& stream)
+		void consumeTexcoord(Stream& stream)
 		{
 			float u = stream.expectFloat();
 
@@ -53,42 +96,75 @@ namespace OBJ
 				if (float w; stream.consumeHorizontalWS() && stream.consumeFloat(w))
 				{
 					stream.expectLineEnd();
-					consumer.consumeTexcoord(stream, u, v, w);
+					emitTexcoord(stream, u, v, w);
 					return;
 				}
 
 				stream.expectLineEnd();
-				consumer.consumeTexcoord(stream, u, v);
+				emitTexcoord(stream, u, v);
 				return;
 			}
 
 			stream.expectLineEnd();
-			consumer.consumeTexcoord(stream, u);
+			emitTexcoord(stream, u);
 		}
 
-		void consumeFace(OBJ::Stream& stream)
+		// parses a face expecting all its vertices to have format F, any vertex that does not goes through
+		// the generic expectFaceVertex; returns false if that was necessary
+		template <parse::FaceFormat F>
+		bool consumeFaceAs(Stream& stream)
 		{
+			bool matched = true;
+
 			do
 			{
-				int v = stream.expectInteger();
-				int t = 0;
-				int n = 0;
+				index_type v, n, t;
 
-				if (stream.consume<'/'>())
+				if (!stream.template consumeFaceVertex<F>(v, n, t))
 				{
-					stream.consumeInteger(t);
-
-					if (stream.consume<'/'>())
-						stream.consumeInteger(n);
+					stream.expectFaceVertex(v, n, t);
+					matched = false;
 				}
 
-				consumer.consumeFaceVertex(stream, v, n, t);
-			} while (!stream.finishLine());
+				emitFaceVertex(stream, v, n, t);
+			} while (!stream.atLineEnd());
 
+			flushFaceVertices(stream);
+			stream.finishLine();
 			consumer.finishFace(stream);
+			return matched;
 		}
 
-		void consumeObjectName(OBJ::Stream& stream)
+		void consumeFace(Stream& stream)
+		{
+			// exporters stick to one face format per file, so the first vertex of a face picks the
+			// parser for all following faces until one of them does not match
+			if (!face_format)
+				face_format = stream.detectFaceFormat();
+
+			bool matched = false;
+
+			switch (*face_format)
+			{
+			case parse::FaceFormat::V:
+				matched = consumeFaceAs<parse::FaceFormat::V>(stream);
+				break;
+			case parse::FaceFormat::VT:
+				matched = consumeFaceAs<parse::FaceFormat::VT>(stream);
+				break;
+			case parse::FaceFormat::VN:
+				matched = consumeFaceAs<parse::FaceFormat::VN>(stream);
+				break;
+			case parse::FaceFormat::VTN:
+				matched = consumeFaceAs<parse::FaceFormat::VTN>(stream);
+				break;
+			}
+
+			if (!matched)
+				face_format.reset();
+		}
+
+		void consumeObjectName(Stream& stream)
 		{
 			auto name = stream.expectNonWS();
 
@@ -101,7 +177,7 @@ namespace OBJ
 			consumer.consumeObjectName(stream, name);
 		}
 
-		void consumeGroupName(OBJ::Stream& stream)
+		void consumeGroupName(Stream& stream)
 		{
 			do
 			{
@@ -112,13 +188,13 @@ namespace OBJ
 			consumer.finishGroupAssignment(stream);
 		}
 
-		void consumeSmoothingGroup(OBJ::Stream& stream)
+		void consumeSmoothingGroup(Stream& stream)
 		{
 			int n;
 
 			if (!stream.consumeInteger(n))
 			{
-				if (stream.consume<'o', 'f', 'f'>())
+				if (stream.template consume<'o', 'f', 'f'>())
 					n = 0;
 				else
 					stream.throwError("expected smoothing group index or 'off'"sv);
@@ -128,113 +204,169 @@ namespace OBJ
 			consumer.consumeSmoothingGroup(stream, n);
 		}
 
-		void consumeMtlLib(OBJ::Stream& stream)
+		void consumeMtlLib(Stream& stream)
 		{
 			auto name = stream.expectNonWS();
 			stream.expectLineEnd();
 			consumer.consumeMtlLib(stream, name);
 		}
 
-		void consumeUseMtl(OBJ::Stream& stream)
+		void consumeUseMtl(Stream& stream)
 		{
 			auto name = stream.expectNonWS();
 			stream.expectLineEnd();
 			consumer.consumeUseMtl(stream, name);
 		}
 
+		// statements of attributes that the consumer does not read are skipped without parsing them
+		void skipStatement(Stream& stream)
+		{
+			stream.skipLine();
+		}
+
+		template <typename T, typename Deliver>
+		static void flushBatch(batch<T>& b, Deliver&& deliver)
+		{
+			if (b.size != 0)
+			{
+				deliver(b.elements, b.size);
+				b.size = 0;
+			}
+		}
+
 	public:
 		Reader(Consumer& consumer)
 			: consumer(consumer)
 		{
 		}
 
-		bool consume(OBJ::Stream& stream, char c)
+		// the emit functions hand parsed elements to the consumer, holding them back in batches if it accepts them
+
+		void emitVertex(Stream& stream, float x, float y, float z)
 		{
-			switch (c)
+			if constexpr (batched)
 			{
-			case 'v':
-				if (stream.consumeHorizontalWS())
-				{
-					consumeVertex(stream);
-					break;
-				}
-				else if (stream.consume<'n'>())
-				{
-					if (stream.consumeHorizontalWS())
-					{
-						consumeNormal(stream);
-						break;
-					}
-				}
-				else if (stream.consume<'t'>())
-				{
-					if (stream.consumeHorizontalWS())
-					{
-						consumeTexcoord(stream);
-						break;
-					}
-				}
-				[[fallthrough]];
+				vertices.elements[vertices.size++] = { x, y, z };
 
-			case 'f':
-				if (stream.consumeHorizontalWS())
-				{
-					consumeFace(stream);
-					break;
-				}
-				[[fallthrough]];
+				if (vertices.size == BATCH_SIZE)
+					flush(stream);
+			}
+			else
+				consumer.consumeVertex(stream, x, y, z);
+		}
 
-			case 'o':
-				if (stream.consumeHorizontalWS())
-				{
-					consumeObjectName(stream);
-					break;
-				}
-				[[fallthrough]];
+		void emitVertex(Stream& stream, float x, float y, float z, float w)
+		{
+			flush(stream);
+			consumer.consumeVertex(stream, x, y, z, w);
+		}
 
-			case 'g':
-				if (stream.consumeHorizontalWS())
-				{
-					consumeGroupName(stream);
-					break;
-				}
-				[[fallthrough]];
+		void emitNormal(Stream& stream, float x, float y, float z)
+		{
+			if constexpr (batched)
+			{
+				normals.elements[normals.size++] = { x, y, z };
 
-			case 's':
-				if (stream.consumeHorizontalWS())
-				{
-					consumeSmoothingGroup(stream);
-					break;
-				}
-				[[fallthrough]];
+				if (normals.size == BATCH_SIZE)
+					flush(stream);
+			}
+			else
+				consumer.consumeNormal(stream, x, y, z);
+		}
 
-			case 'm':
-				if (stream.consume<'t', 'l', 'l', 'i', 'b'>())
-				{
-					if (stream.consumeHorizontalWS())
-						consumeMtlLib(stream);
-					break;
-				}
-				[[fallthrough]];
+		void emitTexcoord(Stream& stream, float u)
+		{
+			flush(stream);
+			consumer.consumeTexcoord(stream, u);
+		}
 
-			case 'u':
-				if (stream.consume<'s', 'e', 'm', 't', 'l'>())
-				{
-					if (stream.consumeHorizontalWS())
-						consumeUseMtl(stream);
-					break;
-				}
-				[[fallthrough]];
+		void emitTexcoord(Stream& stream, float u, float v)
+		{
+			if constexpr (batched)
+			{
+				texcoords.elements[texcoords.size++] = { u, v };
 
-			default:
-				stream.throwError("unknown command"sv);
-				break;
+				if (texcoords.size == BATCH_SIZE)
+					flush(stream);
+			}
+			else
+				consumer.consumeTexcoord(stream, u, v);
+		}
 
-			case '#':
+		void emitTexcoord(Stream& stream, float u, float v, float w)
+		{
+			flush(stream);
+			consumer.consumeTexcoord(stream, u, v, w);
+		}
+
+		// vertex attributes have to be flushed before the first vertex of a face is emitted
+		void emitFaceVertex(Stream& stream, index_type v, index_type n, index_type t)
+		{
+			if constexpr (batched)
+			{
+				face_vertices.elements[face_vertices.size++] = { v, n, t };
+
+				if (face_vertices.size == BATCH_SIZE)
+					flushFaceVertices(stream);
+			}
+			else
+				consumer.consumeFaceVertex(stream, v, n, t);
+		}
+
+		// hands over batched vertex attributes
+		void flush(Stream& stream)
+		{
+			if constexpr (batched)
+			{
+				flushBatch(vertices, [&](const float3* elements, std::size_t count) { consumer.consumeVertices(stream, elements, count); });
+				flushBatch(normals, [&](const float3* elements, std::size_t count) { consumer.consumeNormals(stream, elements, count); });
+				flushBatch(texcoords, [&](const float2* elements, std::size_t count) { consumer.consumeTexcoords(stream, elements, count); });
+			}
+		}
+
+		// hands over the batched vertices of the current face
+		void flushFaceVertices(Stream& stream)
+		{
+			if constexpr (batched)
+				flushBatch(face_vertices, [&](const basic_face_vertex<index_type>* elements, std::size_t count) { consumer.consumeFaceVertices(stream, elements, static_cast<int>(count)); });
+		}
+
+		void finish(Stream& stream)
+		{
+			flush(stream);
+		}
+
+		bool consume(Stream& stream, char c)
+		{
+			if (c == '#')
+			{
 				stream.skipLine();
-				break;
+				return true;
 			}
 
+			static constexpr parse::keyword_table<command> commands = {{
+				{ "v", { &Reader::consumeVertex, true } },
+				{ "vn", { reads(attributes, Attributes::NORMALS) ? &Reader::consumeNormal : &Reader::skipStatement, true } },
+				{ "vt", { reads(attributes, Attributes::TEXCOORDS) ? &Reader::consumeTexcoord : &Reader::skipStatement, true } },
+				{ "f", { &Reader::consumeFace } },
+				{ "o", { &Reader::consumeObjectName } },
+				{ "g", { &Reader::consumeGroupName } },
+				{ "s", { &Reader::consumeSmoothingGroup } },
+				{ "mtllib", { &Reader::consumeMtlLib, false, true } },
+				{ "usemtl", { &Reader::consumeUseMtl, false, true } },
+			}};
+			static_assert(commands.perfect());
+
+			auto cmd = commands.find(stream.consumeCommand());
+
+			if (!cmd || !cmd->attribute)
+				flush(stream);
+
+			if (cmd && stream.consumeHorizontalWS())
+				(this->*cmd->consume)(stream);
+			else if (!cmd || !cmd->ignore_without_arguments)
+				stream.throwError("unknown command"sv);
+
 			return true;
 		}
 	};
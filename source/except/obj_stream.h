@@ -1,242 +1,355 @@
-#ifndef INCLUDED_OBJ_STREAM
-#define INCLUDED_OBJ_STREAM
-
-#pragma once
-
-#include <utility>
-#include <cstdlib>
-#include <charconv>
-#include <string_view>
-#include <iterator>
-#include <iostream>
-
-#include "obj.h"
-
-using namespace std::literals;
-
-
-namespace OBJ
-{
-	class Stream
-	{
-		const char* ptr;
-		const char* end;
-		float size;
-		int line = 1;
-		std::string_view name;
-
-		StreamCallback& callback;
-
-
-		static constexpr bool isHorizontalWS(char c)
-		{
-			return c == ' ' || c == '\t' || c == '\r';
-		}
-
-		static constexpr bool isVerticalWS(char c)
-		{
-			return c == '\n' || c == '\v' || c == '\f';
-		}
-
-		static constexpr bool isWS(char c)
-		{
-			return isHorizontalWS(c) || isVerticalWS(c);
-		}
-
-		void endLine()
-		{
-			if (line % 0x4000 == 0)
-				callback.progress(1.0f - (end - ptr) / size);
-			++line;
-		}
-
-		void endFile()
-		{
-			callback.finish();
-		}
-
-	public:
-		Stream(const char* begin, const char* end, std::string_view name, StreamCallback& callback)
-			: ptr(begin), end(end), size(static_cast<float>(end - begin)), name(name), callback(callback)
-		{
-		}
-
-		[[noreturn]]
-		void throwError(std::string_view msg) const
-		{
-			callback.error(name, line, msg);
-			throw OBJ::parse_error();
-		}
-
-		void warn(std::string_view msg) const
-		{
-			callback.warning(name, line, msg);
-		}
-
-		bool skipLine()
-		{
-			while (ptr != end)
-			{
-				if (*ptr++ == '\n')
-				{
-					endLine();
-					return true;
-				}
-			}
-			return false;
-		}
-
-		template <char... C>
-		bool consume()
-		{
-			static_assert(sizeof...(C) > 0);
-			static_assert(((!isWS(C)) && ...), "consume does not support whitespace characters");
-
-			if (auto c = ptr; ptr + sizeof...(C) < end && ((*c++ == C) && ...))
-			{
-				ptr = c;
-				return true;
-			}
-			return false;
-		}
-
-		//template <char C>
-		//void expect()
-		//{
-		//	if (!consume<C>())
-		//	{
-		//		constexpr const char msg[] = { 'e', 'x', 'p', 'e', 'c', 't', 'e', 'd', '\'', C, '\'' };
-		//		throwError({ msg, std::size(msg) });
-		//	}
-		//}
-
-		bool consumeHorizontalWS()
-		{
-			if (ptr == end || !isHorizontalWS(*ptr))
-				return false;
-
-			while (++ptr, ptr != end && isHorizontalWS(*ptr));
-
-			return true;
-		}
-
-		void expectHorizontalWS()
-		{
-			if (!consumeHorizontalWS())
-				throwError("expected horizontal white space"sv);
-		}
-
-		bool finishLine()
-		{
-			consumeHorizontalWS();
-
-			if (ptr == end)
-				return true;
-
-			if (*ptr == '\n')
-			{
-				++ptr;
-				endLine();
-				return true;
-			}
-
-			return false;
-		}
-
-		void expectLineEnd()
-		{
-			if (!finishLine())
-				throwError("expected newline"sv);
-		}
-
-		std::string_view consumeNonWS()
-		{
-			auto begin = ptr;
-			while (ptr != end && !isWS(*ptr))
-				++ptr;
-			return { begin, static_cast<std::size_t>(ptr - begin) };
-		}
-
-		std::string_view expectNonWS()
-		{
-			auto v = consumeNonWS();
-			if (v.empty())
-				throwError("expected string"sv);
-			return v;
-		}
-
-		bool consumeInteger(int& n)
-		{
-			auto [token_end, err] = std::from_chars(ptr, end, n);
-
-			if (err != std::errc())
-			{
-				if (err == std::errc::result_out_of_range)
-					throwError("integer out of range"sv);
-				return false;
-			}
-
-			ptr = token_end;
-
-			return true;
-		}
-
-		int expectInteger()
-		{
-			if (int n; consumeInteger(n))
-				return n;
-			throwError("expected integer"sv);
-		}
-
-		bool consumeFloat(float& f)
-		{
-			auto [token_end, err] = std::from_chars(ptr, end, f);
-
-			if (err != std::errc())
-			{
-				if (err == std::errc::result_out_of_range)
-					throwError("floating point number out of range"sv);
-				return false;
-			}
-
-			ptr = token_end;
-
-			return true;
-		}
-
-		float expectFloat()
-		{
-			if (float f; consumeFloat(f))
-				return f;
-			throwError("expected floating point number"sv);
-		}
-
-		template <typename Consumer>
-		void consume(Consumer&& consumer)
-		{
-			while (ptr != end)
-			{
-				char c = *ptr++;
-
-				switch (c)
-				{
-				case '\n':
-					endLine();
-				case '\r':
-				case '\t':
-				case ' ':
-					break;
-
-				default:
-					if (!consumer.consume(*this, c))
-						return;
-					break;
-				}
-			}
-
-			endFile();
-		}
-	};
-}
-
-#endif  // INCLUDED_OBJ_STREAM
+#ifndef INCLUDED_OBJ_STREAM
+#define INCLUDED_OBJ_STREAM
+
+#pragma once
+
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <charconv>
+#include <string_view>
+#include <iterator>
+#include <iostream>
+
+#include <parse/scan.h>
+#include <parse/kernels.h>
+#include <parse/integer.h>
+#include <parse/float.h>
+
+#include "obj.h"
+
+using namespace std::literals;
+
+
+namespace OBJ
+{
+	// Callback is a compile-time policy with the member functions of StreamCallback, which is itself
+	// the policy that dispatches them at runtime
+	template <typename Callback>
+	class BasicStream
+	{
+	protected:
+		static constexpr std::ptrdiff_t PROGRESS_INTERVAL = 1 << 19;
+
+		const char* ptr;
+		const char* end;
+		std::size_t size;
+		const char* next_progress;
+		std::string_view name;
+
+		// lines are not counted while parsing, line is the number of the line that counted is on
+		mutable const char* counted;
+		mutable std::int64_t line = 1;
+
+		Callback& callback;
+
+
+		static constexpr bool isHorizontalWS(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		static constexpr bool isVerticalWS(char c)
+		{
+			return c == '\n' || c == '\v' || c == '\f';
+		}
+
+		static constexpr bool isWS(char c)
+		{
+			return isHorizontalWS(c) || isVerticalWS(c);
+		}
+
+		void reportProgress()
+		{
+			// the fraction is only formed from the exact byte counts, which a float would round on large files
+			auto done = size - static_cast<std::size_t>(end - ptr);
+			callback.progress(static_cast<float>(static_cast<double>(done) / static_cast<double>(size)));
+			next_progress = end - ptr > PROGRESS_INTERVAL ? ptr + PROGRESS_INTERVAL : end;
+		}
+
+		void endFile()
+		{
+			callback.finish();
+		}
+
+	public:
+		BasicStream(const char* begin, const char* end, std::string_view name, Callback& callback)
+			: ptr(begin), end(end), size(static_cast<std::size_t>(end - begin)), next_progress(end - begin > PROGRESS_INTERVAL ? begin + PROGRESS_INTERVAL : end), name(name), counted(begin), callback(callback)
+		{
+		}
+
+		[[noreturn]]
+		void throwError(std::string_view msg) const
+		{
+			callback.error(name, lineNumber(), msg);
+			throw OBJ::parse_error();
+		}
+
+		void warn(std::string_view msg) const
+		{
+			callback.warning(name, lineNumber(), msg);
+		}
+
+		// finds the current line by counting the newlines since the last time it was asked for
+		std::int64_t lineNumber() const
+		{
+			line += static_cast<std::int64_t>(parse::activeKernels().countNewlines(counted, ptr));
+			counted = ptr;
+			return line;
+		}
+
+		const char* position() const
+		{
+			return ptr;
+		}
+
+		const char* limit() const
+		{
+			return end;
+		}
+
+		// moves the stream forward to p
+		void advance(const char* p)
+		{
+			ptr = p;
+		}
+
+		// returns the command word that starts with the character consumed last and moves past it
+		std::string_view consumeCommand()
+		{
+			auto begin = ptr - 1;
+
+			while (ptr != end && !isWS(*ptr))
+				++ptr;
+
+			return { begin, static_cast<std::size_t>(ptr - begin) };
+		}
+
+		bool skipLine()
+		{
+			ptr = parse::activeKernels().findNewline(ptr, end);
+
+			if (ptr == end)
+				return false;
+
+			++ptr;
+			return true;
+		}
+
+		template <char... C>
+		bool consume()
+		{
+			static_assert(sizeof...(C) > 0);
+			static_assert(((!isWS(C)) && ...), "consume does not support whitespace characters");
+
+			if (auto c = ptr; ptr + sizeof...(C) < end && ((*c++ == C) && ...))
+			{
+				ptr = c;
+				return true;
+			}
+			return false;
+		}
+
+		//template <char C>
+		//void expect()
+		//{
+		//	if (!consume<C>())
+		//	{
+		//		constexpr const char msg[] = { 'e', 'x', 'p', 'e', 'c', 't', 'e', 'd', '\'', C, '\'' };
+		//		throwError({ msg, std::size(msg) });
+		//	}
+		//}
+
+		bool consumeHorizontalWS()
+		{
+			if (ptr == end || !isHorizontalWS(*ptr))
+				return false;
+
+			ptr = parse::scan::findFirstNotOf<' ', '\t', '\r'>(ptr + 1, end);
+
+			return true;
+		}
+
+		void expectHorizontalWS()
+		{
+			if (!consumeHorizontalWS())
+				throwError("expected horizontal white space"sv);
+		}
+
+		// tells whether only horizontal white space is left on the line, without consuming the newline
+		bool atLineEnd()
+		{
+			consumeHorizontalWS();
+			return ptr == end || *ptr == '\n';
+		}
+
+		bool finishLine()
+		{
+			consumeHorizontalWS();
+
+			if (ptr == end)
+				return true;
+
+			if (*ptr == '\n')
+			{
+				++ptr;
+				return true;
+			}
+
+			return false;
+		}
+
+		void expectLineEnd()
+		{
+			if (!finishLine())
+				throwError("expected newline"sv);
+		}
+
+		std::string_view consumeNonWS()
+		{
+			auto begin = ptr;
+			ptr = parse::scan::findFirstOf<' ', '\t', '\r', '\n', '\v', '\f'>(ptr, end);
+			return { begin, static_cast<std::size_t>(ptr - begin) };
+		}
+
+		std::string_view expectNonWS()
+		{
+			auto v = consumeNonWS();
+			if (v.empty())
+				throwError("expected string"sv);
+			return v;
+		}
+
+		template <typename T>
+		bool consumeInteger(T& n)
+		{
+			auto [token_end, err] = parse::parseInteger(ptr, end, n);
+
+			if (err != std::errc())
+			{
+				if (err == std::errc::result_out_of_range)
+					throwError("integer out of range"sv);
+				return false;
+			}
+
+			ptr = token_end;
+
+			return true;
+		}
+
+		template <typename T = int>
+		T expectInteger()
+		{
+			if (T n; consumeInteger(n))
+				return n;
+			throwError("expected integer"sv);
+		}
+
+		// consumes a face vertex only if it has the slots of format F, leaves anything else to expectFaceVertex
+		template <parse::FaceFormat F, typename T>
+		bool consumeFaceVertex(T& v, T& n, T& t)
+		{
+			if (auto [token_end, err] = parse::parseFaceVertexAs<F>(ptr, end, v, n, t); err == std::errc() && token_end != end)
+			{
+				ptr = token_end;
+				return true;
+			}
+			return false;
+		}
+
+		parse::FaceFormat detectFaceFormat() const
+		{
+			return parse::detectFaceFormat(ptr, end);
+		}
+
+		template <typename T>
+		void expectFaceVertex(T& v, T& n, T& t)
+		{
+			// consume<'/'>() never matches the last character of the input, so a vertex that runs up to the end takes the long way
+			if (auto [token_end, err] = parse::parseFaceVertex(ptr, end, v, n, t); err == std::errc() && token_end != end)
+			{
+				ptr = token_end;
+				return;
+			}
+
+			v = expectInteger<T>();
+			t = 0;
+			n = 0;
+
+			if (consume<'/'>())
+			{
+				consumeInteger(t);
+
+				if (consume<'/'>())
+					consumeInteger(n);
+			}
+		}
+
+		bool consumeFloat(float& f)
+		{
+			auto [token_end, err] = parse::parseFloat(ptr, end, f);
+
+			if (err != std::errc())
+			{
+				if (err == std::errc::result_out_of_range)
+					throwError("floating point number out of range"sv);
+				return false;
+			}
+
+			ptr = token_end;
+
+			return true;
+		}
+
+		float expectFloat()
+		{
+			if (float f; consumeFloat(f))
+				return f;
+			throwError("expected floating point number"sv);
+		}
+
+	protected:
+		// hands the statements up to end to the consumer, returns false if it stopped early; progress is reported
+		// through self, so that streams built on this one (see obj_block_stream.h) can tell how far along they are
+		template <typename Self, typename Consumer>
+		bool consumeStatements(Self& self, Consumer& consumer)
+		{
+			while (ptr != end)
+			{
+				if (isHorizontalWS(*ptr) || *ptr == '\n')
+				{
+					ptr = parse::scan::findFirstNotOf<' ', '\t', '\r', '\n'>(ptr, end);
+
+					if (ptr == end)
+						break;
+				}
+
+				if (ptr >= next_progress)
+					self.reportProgress();
+
+				char c = *ptr++;
+
+				if (!consumer.consume(self, c))
+					return false;
+			}
+
+			return true;
+		}
+
+	public:
+		template <typename Consumer>
+		void consume(Consumer&& consumer)
+		{
+			if (!consumeStatements(*this, consumer))
+				return;
+
+			consumer.finish(*this);
+			endFile();
+		}
+	};
+
+	using Stream = BasicStream<StreamCallback>;
+}
+
+#endif  // INCLUDED_OBJ_STREAM
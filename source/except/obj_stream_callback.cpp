@@ -11,12 +11,12 @@ namespace OBJ
 		std::cout << '\r' << std::fixed << std::setprecision(0) << 100.0f * p << '%' << std::flush;
 	}
 
-	void StdoutStreamCallback::warning(std::string_view file, int line, std::string_view msg)
+	void StdoutStreamCallback::warning(std::string_view file, std::int64_t line, std::string_view msg)
 	{
 		std::cerr << file << '(' << line << "): error: " << msg;
 	}
 
-	void StdoutStreamCallback::error(std::string_view file, int line, std::string_view msg)
+	void StdoutStreamCallback::error(std::string_view file, std::int64_t line, std::string_view msg)
 	{
 		std::cerr << file << '(' << line << "): warning: " << msg;
 	}
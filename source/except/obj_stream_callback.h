@@ -11,8 +11,8 @@ namespace OBJ
 	struct StdoutStreamCallback : virtual StreamCallback
 	{
 		virtual void progress(float progress) override;
-		virtual void warning(std::string_view file, int line, std::string_view msg) override;
-		virtual void error(std::string_view file, int line, std::string_view msg) override;
+		virtual void warning(std::string_view file, std::int64_t line, std::string_view msg) override;
+		virtual void error(std::string_view file, std::int64_t line, std::string_view msg) override;
 		virtual void finish() override;
 	};
 }
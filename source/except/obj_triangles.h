@@ -0,0 +1,107 @@
+#ifndef INCLUDED_OBJ_TRIANGLES
+#define INCLUDED_OBJ_TRIANGLES
+
+#pragma once
+
+#include <string_view>
+#include <type_traits>
+
+#include "obj_stream.h"
+#include "obj_block_stream.h"
+#include "obj_reader.h"
+#include "obj_indexed_reader.h"
+#include "obj_consumer.h"
+#include "obj_parallel.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	// exposes a callback policy through the virtual StreamCallback interface, for the parts that are not templates
+	template <typename Callback>
+	class StreamCallbackAdapter : public StreamCallback
+	{
+		Callback& callback;
+
+	public:
+		StreamCallbackAdapter(Callback& callback)
+			: callback(callback)
+		{
+		}
+
+		void progress(float progress) override
+		{
+			callback.progress(progress);
+		}
+
+		void warning(std::string_view file, std::int64_t line, std::string_view msg) override
+		{
+			callback.warning(file, line, msg);
+		}
+
+		void error(std::string_view file, std::int64_t line, std::string_view msg) override
+		{
+			callback.error(file, line, msg);
+		}
+
+		void finish() override
+		{
+			callback.finish();
+		}
+	};
+
+	template <Attributes A, typename Index = int, typename Stream>
+	BasicTriangles<A, Index> consumeTriangles(Stream& stream, const ReadOptions& options)
+	{
+		BasicOBJConsumer<A, Index> consumer(options.hash_seed);
+
+		if (options.engine == Engine::INDEXED)
+		{
+			IndexedReader<BasicOBJConsumer<A, Index>, Stream> reader(consumer);
+			stream.consume(reader);
+		}
+		else
+		{
+			Reader<BasicOBJConsumer<A, Index>, Stream> reader(consumer);
+			stream.consume(reader);
+		}
+
+		return consumer.finish();
+	}
+
+	template <Attributes A, typename Index = int, typename Callback>
+	BasicTriangles<A, Index> readTrianglesSerial(const char* begin, const char* end, std::string_view name, Callback& stream_callback, const ReadOptions& options)
+	{
+		BasicStream<Callback> stream(begin, end, name, stream_callback);
+		return consumeTriangles<A, Index>(stream, options);
+	}
+
+	template <Attributes A, typename Index = int, typename Callback>
+	BasicTriangles<A, Index> readTrianglesStreamed(ReadCallback& input, std::string_view name, Callback& stream_callback, const ReadOptions& options)
+	{
+		BasicBlockStream<Callback> stream(input, options.block_size, name, stream_callback);
+		return consumeTriangles<A, Index>(stream, options);
+	}
+
+	// readTriangles that reads only the vertex attributes A besides positions, or that takes a callback policy other than
+	// StreamCallback, whose calls are resolved at compile time; only the parallel path, which reports from the calling
+	// thread once all chunks are done, goes through an adapter for such a policy
+	template <Attributes A = Attributes::ALL, typename Index = int, typename Callback, typename = std::enable_if_t<A != Attributes::ALL || !std::is_same_v<Index, int> || !std::is_base_of_v<StreamCallback, Callback>>>
+	BasicTriangles<A, Index> readTriangles(const char* begin, const char* end, std::string_view name, Callback& stream_callback, const ReadOptions& options = {})
+	{
+		if (int num_chunks = parallelChunkCount(end - begin, options.num_threads); num_chunks > 1)
+		{
+			if constexpr (std::is_base_of_v<StreamCallback, Callback>)
+				return readTrianglesParallel<A, Index>(begin, end, name, stream_callback, num_chunks, options);
+			else
+			{
+				StreamCallbackAdapter<Callback> adapter(stream_callback);
+				return readTrianglesParallel<A, Index>(begin, end, name, adapter, num_chunks, options);
+			}
+		}
+
+		return readTrianglesSerial<A, Index>(begin, end, name, stream_callback, options);
+	}
+}
+
+#endif  // INCLUDED_OBJ_TRIANGLES
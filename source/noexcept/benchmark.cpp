@@ -0,0 +1,324 @@
+#include <cstdio>
+#include <memory>
+#include <new>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include <bench/bench.h>
+#include <parse/kernels.h>
+
+#include "obj_triangles.h"
+#include "obj_file.h"
+#include "obj.h"
+
+
+namespace
+{
+	// does nothing, but has to be reached through the virtual interface
+	struct SilentStreamCallback : OBJ::StreamCallback
+	{
+		void progress(float progress) noexcept override
+		{
+		}
+
+		void warning(const char* file, std::int64_t line, const char* msg) noexcept override
+		{
+		}
+
+		void error(const char* file, std::int64_t line, const char* msg) noexcept override
+		{
+		}
+
+		void finish() noexcept override
+		{
+		}
+	};
+
+	// remembers how long it took until the first preview of a progressive load arrived
+	struct PreviewTimer : OBJ::PreviewStreamCallback
+	{
+		std::chrono::steady_clock::time_point start;
+		double first_preview;  // milliseconds
+
+		void progress(float progress) noexcept override
+		{
+		}
+
+		void warning(const char* file, std::int64_t line, const char* msg) noexcept override
+		{
+		}
+
+		void error(const char* file, std::int64_t line, const char* msg) noexcept override
+		{
+		}
+
+		void finish() noexcept override
+		{
+		}
+
+		void preview(const OBJ::Triangles& triangles, std::size_t face_stride) noexcept override
+		{
+			if (first_preview < 0.0)
+				first_preview = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+	};
+
+	struct Buffer
+	{
+		std::unique_ptr<char[]> data;
+		std::size_t size = 0;
+	};
+
+	// hands out the input one block at a time, like a pipe would
+	struct MemoryReadCallback : OBJ::ReadCallback
+	{
+		const char* ptr;
+		const char* end;
+
+		MemoryReadCallback(const Buffer& input) noexcept
+			: ptr(&input.data[0]), end(&input.data[0] + input.size)
+		{
+		}
+
+		std::ptrdiff_t read(char* buffer, std::size_t size) noexcept override
+		{
+			auto n = std::min(size, static_cast<std::size_t>(end - ptr));
+			std::memcpy(buffer, ptr, n);
+			ptr += n;
+			return static_cast<std::ptrdiff_t>(n);
+		}
+	};
+
+	// goes through InputFile, as ftell cannot tell the size of files over 2 GB where long has 32 bits
+	bool readFile(Buffer& out, const char* path) noexcept
+	{
+		OBJ::InputFile file;
+
+		if (file.open(path, OBJ::FileAccess::MAP) != OBJ::error::SUCCESS)
+			return false;
+
+		out.size = static_cast<std::size_t>(file.end() - file.begin());
+		out.data.reset(new (std::nothrow) char[out.size]);
+
+		if (!out.data)
+			return false;
+
+		std::memcpy(&out.data[0], file.begin(), out.size);
+		return true;
+	}
+
+	bool generateInput(Buffer& out) noexcept
+	{
+		constexpr int GRID_SIZE = 500;
+
+		out.size = bench::generateGrid(nullptr, GRID_SIZE);
+		out.data.reset(new (std::nothrow) char[out.size]);
+
+		if (!out.data)
+			return false;
+
+		bench::generateGrid(&out.data[0], GRID_SIZE);
+		return true;
+	}
+
+	// a grid whose vertex map and attributes take up more memory than a last-level cache holds, so that merging face
+	// vertices waits on memory, all the more if its faces are scattered
+	bool generateLargeInput(Buffer& out, bool scattered) noexcept
+	{
+		constexpr int GRID_SIZE = 1500;
+
+		out.size = bench::generateGrid(nullptr, GRID_SIZE, scattered);
+		out.data.reset(new (std::nothrow) char[out.size]);
+
+		if (!out.data)
+			return false;
+
+		bench::generateGrid(&out.data[0], GRID_SIZE, scattered);
+		return true;
+	}
+
+	// faces whose vertices all start probing at the first group of the vertex map when they are hashed without a seed,
+	// as a file crafted against the hash would make them, or as many faces that are not picked for that
+	bool generateCollidingInput(Buffer& out, bool crafted) noexcept
+	{
+		constexpr int NUM_ATTRIBUTES = 1000;
+		constexpr int NUM_CORNERS = 30000;
+		constexpr std::uint64_t GROUP_MASK = (1 << 12) - 1;  // the groups of a table that holds NUM_CORNERS vertices
+
+		// hash_map picks the group by the bits above the 7 that go into the control byte
+		auto pick = [&](int v, int t, int n) noexcept
+		{
+			return !crafted || ((OBJ::vertex_key_hash {}(OBJ::vertex_key<OBJ::Attributes::ALL>::make(v - 1, n, t).pack()) >> 7) & GROUP_MASK) == 0;
+		};
+
+		out.size = bench::generateFaces(nullptr, NUM_ATTRIBUTES, NUM_CORNERS, pick);
+		out.data.reset(new (std::nothrow) char[out.size]);
+
+		if (!out.data)
+			return false;
+
+		bench::generateFaces(&out.data[0], NUM_ATTRIBUTES, NUM_CORNERS, pick);
+		return true;
+	}
+
+	template <OBJ::Attributes A = OBJ::Attributes::ALL, typename Callback>
+	void run(const char* label, const Buffer& input, Callback& callback, const OBJ::ReadOptions& options, int runs = 10) noexcept
+	{
+		OBJ::error result = OBJ::error::SUCCESS;
+
+		auto t = bench::measure(runs, [&]
+		{
+			OBJ::BasicTriangles<A> triangles;
+			result = OBJ::readTriangles(triangles, &input.data[0], &input.data[0] + input.size, "benchmark", callback, options);
+		});
+
+		if (result != OBJ::error::SUCCESS)
+			printf("%-32s failed: %s\n", label, OBJ::describeError(result));
+		else
+			bench::report(label, t, input.size);
+	}
+
+	// includes getting the file into memory, which is what the file access modes differ in; a cold run has the file
+	// dropped from the cache first, which is timed as well
+	void runFile(const char* label, const char* path, std::size_t size, OBJ::FileAccess access, bool cold = false) noexcept
+	{
+		SilentStreamCallback silent;
+		OBJ::ReadOptions options;
+		options.file_access = access;
+		OBJ::error result = OBJ::error::SUCCESS;
+
+		if (cold && !bench::dropFromCache(path))
+		{
+			printf("%-32s not supported\n", label);
+			return;
+		}
+
+		auto t = bench::measure(10, [&]
+		{
+			if (cold)
+				bench::dropFromCache(path);
+
+			OBJ::Triangles triangles;
+			result = OBJ::readTrianglesFromFile(triangles, path, silent, options);
+		});
+
+		if (result != OBJ::error::SUCCESS)
+			printf("%-32s failed: %s\n", label, OBJ::describeError(result));
+		else
+			bench::report(label, t, size);
+	}
+
+	void runStreamed(const char* label, const Buffer& input, const OBJ::ReadOptions& options) noexcept
+	{
+		SilentStreamCallback silent;
+		OBJ::error result = OBJ::error::SUCCESS;
+
+		auto t = bench::measure(10, [&]
+		{
+			OBJ::Triangles triangles;
+			MemoryReadCallback source(input);
+			result = OBJ::readTriangles(triangles, source, "benchmark", silent, options);
+		});
+
+		if (result != OBJ::error::SUCCESS)
+			printf("%-32s failed: %s\n", label, OBJ::describeError(result));
+		else
+			bench::report(label, t, input.size);
+	}
+
+	void runProgressive(const char* label, const Buffer& input, const OBJ::ReadOptions& options) noexcept
+	{
+		PreviewTimer timer;
+		double first_preview = 0.0;
+		OBJ::error result = OBJ::error::SUCCESS;
+
+		auto t = bench::measure(10, [&]
+		{
+			OBJ::Triangles triangles;
+			timer.start = std::chrono::steady_clock::now();
+			timer.first_preview = -1.0;
+			result = OBJ::readTrianglesProgressive(triangles, &input.data[0], &input.data[0] + input.size, "benchmark", timer, options);
+			first_preview = timer.first_preview;
+		});
+
+		if (result != OBJ::error::SUCCESS)
+			printf("%-32s failed: %s\n", label, OBJ::describeError(result));
+		else
+		{
+			bench::report(label, t, input.size);
+			printf("%-32s first preview after %9.3f ms\n", label, first_preview);
+		}
+	}
+}
+
+int main(int argc, const char* argv[])
+{
+	if (argc > 2)
+	{
+		puts("usage: noexcept_benchmark [<filename>]");
+		return -2;
+	}
+
+	Buffer input;
+	if (!(argc > 1 ? readFile(input, argv[1]) : generateInput(input)))
+	{
+		puts("error: failed to read input");
+		return -1;
+	}
+
+	SilentStreamCallback silent;
+	OBJ::NullStreamCallback null;
+
+	run("virtual StreamCallback", input, silent, {});
+	run("NullStreamCallback", input, null, {});
+	run("virtual StreamCallback, indexed", input, silent, { 1, OBJ::Engine::INDEXED });
+	run("NullStreamCallback, indexed", input, null, { 1, OBJ::Engine::INDEXED });
+	run<OBJ::Attributes::POSITIONS>("NullStreamCallback, positions", input, null, {});
+	run<OBJ::Attributes::NORMALS>("NullStreamCallback, normals", input, null, {});
+	run<OBJ::Attributes::TEXCOORDS>("NullStreamCallback, texcoords", input, null, {});
+	runStreamed("streamed", input, {});
+	runProgressive("progressive", input, {});
+
+	if (Buffer scattered, crafted; generateCollidingInput(scattered, false) && generateCollidingInput(crafted, true))
+	{
+		std::random_device random;
+		OBJ::ReadOptions seeded;
+		seeded.hash_seed = std::uint64_t(random()) << 32 | random();
+
+		run("scattered faces", scattered, null, {});
+		run("crafted faces", crafted, null, {});
+		run("crafted faces, seeded", crafted, null, seeded);
+	}
+
+	// each of these takes seconds, fewer runs have to do
+	if (Buffer large; generateLargeInput(large, false))
+		run("large grid", large, null, {}, 3);
+
+	if (Buffer large; generateLargeInput(large, true))
+		run("large grid, scattered faces", large, null, {}, 3);
+
+	if (argc > 1)
+	{
+		runFile("file, read", argv[1], input.size, OBJ::FileAccess::READ);
+		runFile("file, map", argv[1], input.size, OBJ::FileAccess::MAP);
+		runFile("file, populate", argv[1], input.size, OBJ::FileAccess::POPULATE);
+		runFile("file, stream", argv[1], input.size, OBJ::FileAccess::STREAM);
+		runFile("cold file, read", argv[1], input.size, OBJ::FileAccess::READ, true);
+		runFile("cold file, map", argv[1], input.size, OBJ::FileAccess::MAP, true);
+		runFile("cold file, stream", argv[1], input.size, OBJ::FileAccess::STREAM, true);
+	}
+
+	for (auto isa : parse::all_instruction_sets)
+	{
+		if (!parse::useKernels(isa))
+			continue;
+
+		char label[64];
+		snprintf(label, sizeof(label), "indexed, %s kernels", parse::name(isa).data());
+		run(label, input, null, { 1, OBJ::Engine::INDEXED });
+	}
+
+	return 0;
+}
@@ -4,17 +4,39 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <utility>
-#include <new>
-#include <memory>
+#include <type_traits>
 #include <optional>
 #include <functional>
-#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_MAP_SSE2
+#endif
+
+#include <parse/bits.h>
 
 #include "dynamic_array.h"
 
 
-template <typename Key, typename Value, typename Hash = std::hash<Key>>
+// a hasher that declares is_avalanching makes hashes that are mixed well enough to be used as they are
+template <typename Hash, typename = void>
+struct hash_is_avalanching : std::false_type
+{
+};
+
+template <typename Hash>
+struct hash_is_avalanching<Hash, std::void_t<typename Hash::is_avalanching>> : std::true_type
+{
+};
+
+// an open addressing hash map in the style of SwissTable: every slot has a control byte that is either EMPTY or
+// holds 7 bits of the hash of its key, and lookups compare the control bytes of a whole group of slots at once,
+// only looking at the keys whose bits match; groups are probed quadratically. Elements cannot be erased, and
+// pointers to them stay valid until the next insertion. Key and Value have to be trivial types, which is what
+// dynamic_array can hold
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
 class hash_map
 {
 public:
@@ -23,27 +45,282 @@ public:
 	using size_type = std::size_t;
 	using difference_type = std::ptrdiff_t;
 	using hasher = Hash;
-	using value_type = std::pair<const Key, Value>;
+	using key_equal = KeyEqual;
+
+	// laid out like std::pair, whose constructors would keep dynamic_array from holding it; first must not be changed
+	struct value_type
+	{
+		Key first;
+		Value second;
+	};
+
 	using reference = value_type&;
 	using const_reference = const value_type&;
 	using pointer = value_type*;
 	using const_pointer = const value_type*;
 
 private:
-	dynamic_array<value_type> table;
+	static constexpr size_type GROUP_WIDTH = 16;
+	static constexpr std::int8_t EMPTY = -128;
+
+	// the control bytes of GROUP_WIDTH consecutive slots
+	class group
+	{
+#if defined(HASH_MAP_SSE2)
+		__m128i ctrl;
+
+	public:
+		explicit group(const std::int8_t* p) noexcept
+			: ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)))
+		{
+		}
+
+		std::uint32_t match(std::int8_t h2) const noexcept
+		{
+			return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2))));
+		}
+
+		// EMPTY is the only control byte with its high bit set
+		std::uint32_t matchEmpty() const noexcept
+		{
+			return static_cast<std::uint32_t>(_mm_movemask_epi8(ctrl));
+		}
+#else
+		const std::int8_t* ctrl;
+
+	public:
+		explicit group(const std::int8_t* p) noexcept
+			: ctrl(p)
+		{
+		}
+
+		std::uint32_t match(std::int8_t h2) const noexcept
+		{
+			std::uint32_t m = 0;
+			for (size_type i = 0; i < GROUP_WIDTH; ++i)
+				m |= static_cast<std::uint32_t>(ctrl[i] == h2) << i;
+			return m;
+		}
+
+		std::uint32_t matchEmpty() const noexcept
+		{
+			return match(EMPTY);
+		}
+#endif
+	};
+
+	dynamic_array<std::int8_t> ctrl;
+	dynamic_array<value_type> slots;
+	size_type num_elements = 0;
+	[[no_unique_address]] Hash hash;
+	[[no_unique_address]] KeyEqual equal;
+
+	size_type homeGroup(std::uint64_t h) const noexcept
+	{
+		return ((h >> 7) & (ctrl.size() / GROUP_WIDTH - 1)) * GROUP_WIDTH;
+	}
 
-	bool resize()
+	static std::int8_t h2(std::uint64_t h) noexcept
 	{
-		return table.size() * 4 > table.capacity() * 3;
+		return static_cast<std::int8_t>(h & 0x7F);
+	}
+
+	size_type groupMask() const noexcept
+	{
+		return ctrl.size() / GROUP_WIDTH - 1;
+	}
+
+	template <typename F>
+	size_type probe(std::uint64_t h, F&& f) const noexcept
+	{
+		auto mask = groupMask();
+
+		for (size_type g = homeGroup(h) / GROUP_WIDTH, step = 0; ; g = (g + ++step) & mask)
+		{
+			group grp(&ctrl[g * GROUP_WIDTH]);
+
+			if (auto i = f(grp, g * GROUP_WIDTH); i != ctrl.size())
+				return i;
+		}
+	}
+
+	// the slot of key or of the first empty one along its probe sequence, the table must not be full
+	size_type findSlot(const key_type& key, std::uint64_t h) const noexcept
+	{
+		return probe(h, [&](const group& grp, size_type base) noexcept
+		{
+			for (auto m = grp.match(h2(h)); m != 0; m &= m - 1)
+			{
+				auto i = base + parse::countTrailingZeros(m);
+				if (equal(slots[i].first, key))
+					return i;
+			}
+
+			if (auto m = grp.matchEmpty(); m != 0)
+				return base + parse::countTrailingZeros(m);
+
+			return ctrl.size();
+		});
+	}
+
+	// moves all elements into a table of new_capacity slots, a power of two that is a multiple of GROUP_WIDTH
+	[[nodiscard]]
+	bool rehash(size_type new_capacity) noexcept
+	{
+		dynamic_array<std::int8_t> new_ctrl;
+		dynamic_array<value_type> new_slots;
+
+		if (!new_ctrl.resize(new_capacity, EMPTY) || !new_slots.resize(new_capacity, value_type()))
+			return false;
+
+		std::swap(ctrl, new_ctrl);
+		std::swap(slots, new_slots);
+
+		for (size_type i = 0; i < new_ctrl.size(); ++i)
+		{
+			if (new_ctrl[i] == EMPTY)
+				continue;
+
+			auto h = hashOf(new_slots[i].first);
+			auto j = findSlot(new_slots[i].first, h);
+
+			ctrl[j] = h2(h);
+			slots[j] = new_slots[i];
+		}
+
+		return true;
+	}
+
+	// the table grows once it would be more than 3/4 full after another insertion
+	bool resize() const noexcept
+	{
+		return (num_elements + 1) * 4 > ctrl.size() * 3;
 	}
 
 public:
+	hash_map() = default;
+
+	explicit hash_map(const Hash& hash) noexcept
+		: hash(hash)
+	{
+	}
+
+	hash_map(hash_map&&) = default;
+
+	hash_map& operator =(hash_map&&) = default;
+
+	size_type size() const noexcept
+	{
+		return num_elements;
+	}
+
+	bool empty() const noexcept
+	{
+		return num_elements == 0;
+	}
+
+	// makes room for n elements without growing again
+	[[nodiscard]]
+	bool reserve(size_type n) noexcept
+	{
+		size_type capacity = GROUP_WIDTH;
+		while (capacity * 3 < n * 4)
+			capacity *= 2;
+
+		return capacity <= ctrl.size() || rehash(capacity);
+	}
+
+	// the hash of a key mixed so that its low bits, which pick the group and the control byte, depend on all of it
+	std::uint64_t hashOf(const key_type& key) const noexcept
+	{
+		if constexpr (hash_is_avalanching<Hash>::value)
+			return static_cast<std::uint64_t>(hash(key));
+		else
+		{
+			std::uint64_t h = static_cast<std::uint64_t>(hash(key)) * 0x9E3779B97F4A7C15ULL;
+			return h ^ (h >> 32);
+		}
+	}
+
+	// asks for the control bytes that a lookup with hash h starts at to be loaded, so that a batch of lookups can
+	// wait for all of theirs at once; followed by prefetchSlot once they are there, and by the lookup after that
+	void prefetchGroup(std::uint64_t h) const noexcept
+	{
+		if (ctrl.size() != 0)
+			parse::prefetch(&ctrl[homeGroup(h)]);
+	}
+
+	// asks for the slot that a lookup with hash h most likely ends at to be loaded: the first one in its group whose
+	// control byte matches, or else the first empty one
+	void prefetchSlot(std::uint64_t h) const noexcept
+	{
+		if (ctrl.size() == 0)
+			return;
+
+		auto base = homeGroup(h);
+		group grp(&ctrl[base]);
+
+		if (auto m = grp.match(h2(h)) | grp.matchEmpty(); m != 0)
+			parse::prefetch(&slots[base + parse::countTrailingZeros(m)]);
+	}
+
+	pointer find(const key_type& key) noexcept
+	{
+		if (num_elements == 0)
+			return nullptr;
+
+		auto i = findSlot(key, hashOf(key));
+		return ctrl[i] != EMPTY ? &slots[i] : nullptr;
+	}
+
+	// calls f with every element, in no particular order
+	template <typename F>
+	void forEach(F&& f) const noexcept
+	{
+		for (size_type i = 0; i < ctrl.size(); ++i)
+		{
+			if (ctrl[i] != EMPTY)
+				f(slots[i]);
+		}
+	}
+
+	// inserts a value constructed from args under key unless there already is one, returns where it is and whether
+	// it was inserted, or nothing if the table could not grow
 	template <typename... Args>
-	std::optional<std::pair<pointer, bool>> try_emplace(const key_type& key, Args&&... args)
+	[[nodiscard]]
+	std::optional<std::pair<pointer, bool>> try_emplace(const key_type& key, Args&&... args) noexcept
 	{
-		return {};
+		return try_emplace_hashed(hashOf(key), key, std::forward<Args>(args)...);
 	}
 
+	// try_emplace for a key whose hashOf is h
+	template <typename... Args>
+	[[nodiscard]]
+	std::optional<std::pair<pointer, bool>> try_emplace_hashed(std::uint64_t h, const key_type& key, Args&&... args) noexcept
+	{
+		auto i = ctrl.size();
+
+		if (ctrl.size() != 0)
+		{
+			if (i = findSlot(key, h); ctrl[i] != EMPTY)
+				return std::pair { &slots[i], false };
+		}
+
+		if (resize())
+		{
+			if (!rehash(ctrl.size() != 0 ? ctrl.size() * 2 : GROUP_WIDTH))
+				return {};
+
+			i = findSlot(key, h);
+		}
+
+		ctrl[i] = h2(h);
+		++num_elements;
+
+		slots[i] = { key, Value(std::forward<Args>(args)...) };
+
+		return std::pair { &slots[i], true };
+	}
 };
 
 #endif  // INCLUDED_HASH_MAP
@@ -1,45 +1,257 @@
-#include <cstdio>
-#include <iterator>
-
-#include "obj_stream_callback.h"
-#include "obj.h"
-
-
-namespace
-{
-	void printUsage()
-	{
-		puts("objstat <filename>");
-	}
-}
-
-int main(int argc, const char* argv[])
-{
-	if (argc < 2)
-	{
-		puts("error: expected <filename>\n");
-		printUsage();
-		return -2;
-	}
-	else if (argc > 2)
-	{
-		puts("error: too many arguments\n");
-		printUsage();
-		return -1;
-	}
-
-	OBJ::StdoutStreamCallback callback;
-	OBJ::Triangles obj;
-	if (auto err = OBJ::readTrianglesFromFile(obj, argv[1], callback); err != OBJ::error::SUCCESS)
-	{
-		printf("error: %s", OBJ::describeError(err));
-		return -1;
-	}
-
-	if (!obj.triangles.push_back({}))
-		return -1;
-
-	printf("%zu positions, %zu normals, %zu texcoords, %zu triangles\n", size(obj.positions), size(obj.normals), size(obj.texcoords), size(obj.triangles));
-
-	return 0;
-}
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+
+#include <parse/kernels.h>
+
+#include "obj_stream_callback.h"
+#include "obj_incremental.h"
+#include "obj.h"
+
+
+namespace
+{
+	void printUsage()
+	{
+		puts("objstat [-j <threads>] [-e reader|indexed] [-k scalar|sse2|avx2|avx512] [-f map|populate|read|stream] [-p|-t] <filename>|-");
+	}
+
+	bool parseThreadCount(int& n, const char* arg)
+	{
+		char* end;
+		long value = std::strtol(arg, &end, 10);
+		if (end == arg || *end != '\0' || value < 0 || value > 0xFFFF)
+			return false;
+		n = static_cast<int>(value);
+		return true;
+	}
+
+	bool parseEngine(OBJ::Engine& engine, const char* arg)
+	{
+		if (std::strcmp(arg, "reader") == 0)
+			engine = OBJ::Engine::READER;
+		else if (std::strcmp(arg, "indexed") == 0)
+			engine = OBJ::Engine::INDEXED;
+		else
+			return false;
+		return true;
+	}
+
+	bool parseFileAccess(OBJ::FileAccess& access, const char* arg)
+	{
+		if (std::strcmp(arg, "map") == 0)
+			access = OBJ::FileAccess::MAP;
+		else if (std::strcmp(arg, "populate") == 0)
+			access = OBJ::FileAccess::POPULATE;
+		else if (std::strcmp(arg, "read") == 0)
+			access = OBJ::FileAccess::READ;
+		else if (std::strcmp(arg, "stream") == 0)
+			access = OBJ::FileAccess::STREAM;
+		else
+			return false;
+		return true;
+	}
+
+	// reports how long it took until each preview of a progressive load arrived
+	struct StdoutPreviewStreamCallback : OBJ::StdoutStreamCallback, OBJ::PreviewStreamCallback
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		void preview(const OBJ::Triangles& triangles, std::size_t face_stride) noexcept override
+		{
+			auto t = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			printf("\rpreview after %g ms: %zu triangles from every %zu. face\n", t, size(triangles.triangles), face_stride);
+		}
+	};
+
+	// objstat - reads from stdin, one block at a time
+	struct StdinReadCallback : OBJ::ReadCallback
+	{
+		std::ptrdiff_t read(char* buffer, std::size_t size) noexcept override
+		{
+			auto n = std::fread(buffer, 1, size, stdin);
+
+			if (n == 0 && std::ferror(stdin))
+				return -1;
+
+			return static_cast<std::ptrdiff_t>(n);
+		}
+	};
+
+	// overrides the instruction set that is picked for the scanning kernels
+	bool selectKernels(const char* arg)
+	{
+		auto isa = parse::parseInstructionSet(arg);
+		return isa && parse::useKernels(*isa);
+	}
+
+	template <typename Triangles>
+	int printStatistics(Triangles& obj)
+	{
+		if (!obj.triangles.push_back({}))
+			return -1;
+
+		printf("%zu positions, %zu normals, %zu texcoords, %zu triangles\n", size(obj.positions), size(obj.normals), size(obj.texcoords), size(obj.triangles));
+
+		return 0;
+	}
+
+	// objstat -t follows the file, printing its statistics again whenever it changes, until it is interrupted
+	int tail(const char* filename, OBJ::StreamCallback& callback, const OBJ::ReadOptions& options)
+	{
+		OBJ::IncrementalOBJ obj;
+
+		if (auto err = obj.open(filename, callback, options); err != OBJ::error::SUCCESS)
+		{
+			printf("error: %s", OBJ::describeError(err));
+			return -1;
+		}
+
+		for (;;)
+		{
+			printf("%zu positions, %zu normals, %zu texcoords, %zu triangles\n", size(obj.positions()), size(obj.normals()), size(obj.texcoords()), size(obj.triangles()));
+			fflush(stdout);
+
+			for (auto change = OBJ::IncrementalOBJ::Change::NONE; change == OBJ::IncrementalOBJ::Change::NONE; )
+			{
+				// the callback has reported what went wrong, the next change reads the file again
+				if (obj.waitForChange(std::chrono::seconds(1)) && obj.update(change) != OBJ::error::SUCCESS)
+					change = OBJ::IncrementalOBJ::Change::NONE;
+			}
+		}
+	}
+}
+
+int main(int argc, const char* argv[])
+{
+	OBJ::ReadOptions options;
+	const char* filename = nullptr;
+	bool progressive = false;
+	bool follow = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "-j") == 0)
+		{
+			if (++i >= argc || !parseThreadCount(options.num_threads, argv[i]))
+			{
+				puts("error: expected <threads>\n");
+				printUsage();
+				return -2;
+			}
+		}
+		else if (std::strcmp(argv[i], "-e") == 0)
+		{
+			if (++i >= argc || !parseEngine(options.engine, argv[i]))
+			{
+				puts("error: expected <engine>\n");
+				printUsage();
+				return -2;
+			}
+		}
+		else if (std::strcmp(argv[i], "-k") == 0)
+		{
+			if (++i >= argc || !selectKernels(argv[i]))
+			{
+				puts("error: expected supported <instruction set>\n");
+				printUsage();
+				return -2;
+			}
+		}
+		else if (std::strcmp(argv[i], "-f") == 0)
+		{
+			if (++i >= argc || !parseFileAccess(options.file_access, argv[i]))
+			{
+				puts("error: expected <file access>\n");
+				printUsage();
+				return -2;
+			}
+		}
+		else if (std::strcmp(argv[i], "-p") == 0)
+		{
+			progressive = true;
+		}
+		else if (std::strcmp(argv[i], "-t") == 0)
+		{
+			follow = true;
+		}
+		else if (!filename)
+		{
+			filename = argv[i];
+		}
+		else
+		{
+			puts("error: too many arguments\n");
+			printUsage();
+			return -1;
+		}
+	}
+
+	if (!filename)
+	{
+		puts("error: expected <filename>\n");
+		printUsage();
+		return -2;
+	}
+
+	bool from_stdin = std::strcmp(filename, "-") == 0;
+
+	if (from_stdin && progressive)
+	{
+		puts("error: stdin cannot be read progressively\n");
+		printUsage();
+		return -2;
+	}
+
+	if (progressive && follow)
+	{
+		puts("error: -p and -t cannot be combined\n");
+		printUsage();
+		return -2;
+	}
+
+	if (from_stdin && follow)
+	{
+		puts("error: stdin cannot be followed\n");
+		printUsage();
+		return -2;
+	}
+
+	StdoutPreviewStreamCallback callback;
+
+	if (follow)
+		return tail(filename, callback, options);
+
+	// only files that could have more vertices than an int can index pay for 64-bit indices
+	if (std::error_code ec; !from_stdin && !progressive && OBJ::needsWideIndices(std::filesystem::file_size(filename, ec)) && !ec)
+	{
+		OBJ::Triangles64 obj;
+
+		if (auto err = OBJ::readTrianglesFromFile(obj, filename, callback, options); err != OBJ::error::SUCCESS)
+		{
+			printf("error: %s", OBJ::describeError(err));
+			return -1;
+		}
+
+		return printStatistics(obj);
+	}
+
+	StdinReadCallback input;
+	OBJ::Triangles obj;
+
+	auto err = from_stdin ? OBJ::readTriangles(obj, input, "stdin", callback, options)
+	         : progressive ? OBJ::readTrianglesProgressiveFromFile(obj, filename, callback, options)
+	         : OBJ::readTrianglesFromFile(obj, filename, callback, options);
+
+	if (err != OBJ::error::SUCCESS)
+	{
+		printf("error: %s", OBJ::describeError(err));
+		return -1;
+	}
+
+	return printStatistics(obj);
+}
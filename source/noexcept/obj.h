@@ -1,58 +1,211 @@
-#ifndef INCLUDED_OBJ
-#define INCLUDED_OBJ
-
-#pragma once
-
-#include <array>
-#include <vector>
-
-#include <math/vector.h>
-
-#include "dynamic_array.h"
-
-
-namespace OBJ
-{
-	enum class error
-	{
-		SUCCESS = 0,
-		FAILED_TO_OPEN_FILE,
-		FAILED_TO_READ_FILE,
-		SYNTAX_ERROR,
-		UNSUPPORTED_FEATURE,
-		ALLOCATION_FAILED
-	};
-
-	const char* describeError(error) noexcept;
-
-
-	struct StreamCallback
-	{
-		virtual void progress(float progress) noexcept = 0;
-		virtual void warning(const char* file, int line, const char* msg) noexcept = 0;
-		virtual void error(const char* file, int line, const char* msg) noexcept = 0;
-		virtual void finish() noexcept = 0;
-
-	protected:
-		StreamCallback() = default;
-		StreamCallback(StreamCallback&&) = default;
-		StreamCallback(const StreamCallback&) = default;
-		StreamCallback& operator =(StreamCallback&&) = default;
-		StreamCallback& operator =(const StreamCallback&) = default;
-		~StreamCallback() = default;
-	};
-
-
-	struct Triangles
-	{
-		dynamic_array<float3> positions;
-		dynamic_array<float3> normals;
-		dynamic_array<float2> texcoords;
-		dynamic_array<std::array<int, 3>> triangles;
-	};
-
-	error readTriangles(Triangles& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback) noexcept;
-	error readTrianglesFromFile(Triangles& out, const char* path, StreamCallback& stream_callback) noexcept;
-}
-
-#endif  // INCLUDED_OBJ
+#ifndef INCLUDED_OBJ
+#define INCLUDED_OBJ
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <array>
+#include <vector>
+
+#include <math/vector.h>
+
+#include "dynamic_array.h"
+
+
+namespace OBJ
+{
+	enum class error
+	{
+		SUCCESS = 0,
+		FAILED_TO_OPEN_FILE,
+		FAILED_TO_READ_FILE,
+		SYNTAX_ERROR,
+		UNSUPPORTED_FEATURE,
+		ALLOCATION_FAILED
+	};
+
+	const char* describeError(error) noexcept;
+
+
+	struct StreamCallback
+	{
+		virtual void progress(float progress) noexcept = 0;
+		virtual void warning(const char* file, std::int64_t line, const char* msg) noexcept = 0;
+		virtual void error(const char* file, std::int64_t line, const char* msg) noexcept = 0;
+		virtual void finish() noexcept = 0;
+
+	protected:
+		StreamCallback() = default;
+		StreamCallback(StreamCallback&&) = default;
+		StreamCallback(const StreamCallback&) = default;
+		StreamCallback& operator =(StreamCallback&&) = default;
+		StreamCallback& operator =(const StreamCallback&) = default;
+		~StreamCallback() = default;
+	};
+
+	// Stream takes its callback as a compile-time policy, StreamCallback being the one that dispatches at runtime;
+	// this policy ignores everything and compiles away (see obj_triangles.h)
+	struct NullStreamCallback
+	{
+		void progress(float progress) noexcept
+		{
+		}
+
+		void warning(const char* file, std::int64_t line, const char* msg) noexcept
+		{
+		}
+
+		void error(const char* file, std::int64_t line, const char* msg) noexcept
+		{
+		}
+
+		void finish() noexcept
+		{
+		}
+	};
+
+
+	// the vertex attributes that are read besides positions; the statements of all others are skipped without being parsed
+	enum class Attributes : unsigned
+	{
+		POSITIONS = 0U,
+		NORMALS = 1U << 0,
+		TEXCOORDS = 1U << 1,
+		ALL = NORMALS | TEXCOORDS
+	};
+
+	constexpr Attributes operator |(Attributes a, Attributes b) noexcept
+	{
+		return static_cast<Attributes>(static_cast<unsigned>(a) | static_cast<unsigned>(b));
+	}
+
+	constexpr bool reads(Attributes attributes, Attributes a) noexcept
+	{
+		return (static_cast<unsigned>(attributes) & static_cast<unsigned>(a)) == static_cast<unsigned>(a);
+	}
+
+	namespace detail
+	{
+		template <bool>
+		struct TriangleNormals
+		{
+		};
+
+		template <>
+		struct TriangleNormals<true>
+		{
+			dynamic_array<float3> normals;
+		};
+
+		template <bool>
+		struct TriangleTexcoords
+		{
+		};
+
+		template <>
+		struct TriangleTexcoords<true>
+		{
+			dynamic_array<float2> texcoords;
+		};
+	}
+
+	// only has the normals and texcoords arrays if A reads them
+	template <Attributes A, typename Index = int>
+	struct BasicTriangles : detail::TriangleNormals<reads(A, Attributes::NORMALS)>, detail::TriangleTexcoords<reads(A, Attributes::TEXCOORDS)>
+	{
+		static constexpr Attributes attributes = A;
+		using index_type = Index;
+
+		dynamic_array<float3> positions;
+		dynamic_array<std::array<Index, 3>> triangles;
+	};
+
+	using Triangles = BasicTriangles<Attributes::ALL>;
+	using Triangles64 = BasicTriangles<Attributes::ALL, std::int64_t>;
+
+	// whether input of input_size bytes can have more vertices than an int can index; every face vertex takes at least
+	// two bytes, and no statement makes more than one output vertex per face vertex
+	constexpr bool needsWideIndices(std::uint64_t input_size) noexcept
+	{
+		return input_size / 2 > static_cast<std::uint64_t>(INT_MAX);
+	}
+
+	enum class Engine
+	{
+		READER,  // converts the input in a single pass as it scans it
+		INDEXED  // indexes the tokens of a window of lines first, then converts them
+	};
+
+	enum class FileAccess
+	{
+		MAP,       // parses the file where the system maps it, files that cannot be mapped are read
+		POPULATE,  // maps the file and has all of it paged in up front, in huge pages where the system supports them
+		READ,      // copies the file into memory before parsing it
+		STREAM     // reads the file in blocks on a thread of its own while the ones before are parsed, see block_size;
+		           // readTrianglesProgressive, which needs all of the file at once, maps it instead
+	};
+
+	struct ReadOptions
+	{
+		int num_threads = 1;  // 0 selects one thread per hardware thread
+		Engine engine = Engine::READER;
+		FileAccess file_access = FileAccess::MAP;  // only used by the functions that read a file
+		std::size_t block_size = 1 << 20;  // how much readTriangles pulls from a ReadCallback or a STREAM file at a time
+		std::uint64_t hash_seed = 0;  // mixed into the hashes that face vertices are merged by; pick one at random for
+		                              // files that cannot be trusted, so that they cannot be crafted to make them collide
+	};
+
+	// where readTriangles pulls its input from when it does not have all of it in memory
+	struct ReadCallback
+	{
+		// fills buffer with up to size bytes of input and returns how many, 0 once there are no more and -1 if reading failed
+		virtual std::ptrdiff_t read(char* buffer, std::size_t size) noexcept = 0;
+
+	protected:
+		ReadCallback() = default;
+		ReadCallback(ReadCallback&&) = default;
+		ReadCallback(const ReadCallback&) = default;
+		ReadCallback& operator =(ReadCallback&&) = default;
+		ReadCallback& operator =(const ReadCallback&) = default;
+		~ReadCallback() = default;
+	};
+
+	error readTriangles(Triangles& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, const ReadOptions& options = {}) noexcept;
+
+	// files that are gzip compressed (.obj.gz) are inflated a block at a time on a thread of their own while the blocks
+	// before are parsed
+	error readTrianglesFromFile(Triangles& out, const char* path, StreamCallback& stream_callback, const ReadOptions& options = {}) noexcept;
+
+	// reads input one block of options.block_size at a time, which works for pipes and keeps only about two blocks in
+	// memory; always runs on a single thread. Input that is gzip compressed is inflated as it is read
+	error readTriangles(Triangles& out, ReadCallback& input, const char* name, StreamCallback& stream_callback, const ReadOptions& options = {}) noexcept;
+
+	// the same as readTriangles, but with 64-bit indices for input that needsWideIndices
+	error readTriangles(Triangles64& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, const ReadOptions& options = {}) noexcept;
+	error readTrianglesFromFile(Triangles64& out, const char* path, StreamCallback& stream_callback, const ReadOptions& options = {}) noexcept;
+
+	// a StreamCallback that is also shown the triangles while readTrianglesProgressive is still loading them
+	struct PreviewStreamCallback : virtual StreamCallback
+	{
+		// triangles are those of every face_stride-th face of the file, each call has a smaller face_stride than the one
+		// before, the last one is made with all triangles and a face_stride of 1
+		virtual void preview(const Triangles& triangles, std::size_t face_stride) noexcept = 0;
+
+	protected:
+		PreviewStreamCallback() = default;
+		PreviewStreamCallback(PreviewStreamCallback&&) = default;
+		PreviewStreamCallback(const PreviewStreamCallback&) = default;
+		PreviewStreamCallback& operator =(PreviewStreamCallback&&) = default;
+		PreviewStreamCallback& operator =(const PreviewStreamCallback&) = default;
+		~PreviewStreamCallback() = default;
+	};
+
+	// reads the same as readTriangles, but first shows stream_callback coarse previews made from a sample of the faces;
+	// compressed files are UNSUPPORTED_FEATURE
+	error readTrianglesProgressive(Triangles& out, const char* begin, const char* end, const char* name, PreviewStreamCallback& stream_callback, const ReadOptions& options = {}) noexcept;
+	error readTrianglesProgressiveFromFile(Triangles& out, const char* path, PreviewStreamCallback& stream_callback, const ReadOptions& options = {}) noexcept;
+}
+
+#endif  // INCLUDED_OBJ
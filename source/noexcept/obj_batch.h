@@ -0,0 +1,78 @@
+#ifndef INCLUDED_OBJ_BATCH
+#define INCLUDED_OBJ_BATCH
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+#include <math/vector.h>
+
+
+namespace OBJ
+{
+	template <typename Index>
+	struct basic_face_vertex
+	{
+		Index v, n, t;
+
+		friend constexpr bool operator ==(const basic_face_vertex& a, const basic_face_vertex& b) noexcept
+		{
+			return a.v == b.v && a.n == b.n && a.t == b.t;
+		}
+	};
+
+	using face_vertex_t = basic_face_vertex<int>;
+
+	// the type a consumer takes face vertex indices as, int unless it declares an index_type member
+	template <typename Consumer, typename = void>
+	struct consumer_index
+	{
+		using type = int;
+	};
+
+	template <typename Consumer>
+	struct consumer_index<Consumer, std::void_t<typename Consumer::index_type>>
+	{
+		using type = typename Consumer::index_type;
+	};
+
+	template <typename Consumer>
+	using consumer_index_t = typename consumer_index<Consumer>::type;
+
+	constexpr std::size_t BATCH_SIZE = 256;
+
+	// a run of parsed elements that the Reader holds back until it is full or something else comes along
+	template <typename T>
+	struct batch
+	{
+		T elements[BATCH_SIZE];
+		std::size_t size = 0;
+	};
+
+	// A consumer opts into the batch protocol by providing
+	//   consumeVertices(stream, const float3* vertices, std::size_t count)
+	//   consumeNormals(stream, const float3* normals, std::size_t count)
+	//   consumeTexcoords(stream, const float2* texcoords, std::size_t count)
+	//   consumeFaceVertices(stream, const basic_face_vertex<index_type>* vertices, int count)
+	// which are equivalent to count calls of the corresponding single-element function. Vertices, normals
+	// and 2D texture coordinates are delivered in batches of up to BATCH_SIZE that are flushed before any other
+	// statement, the vertices of a face in spans of up to BATCH_SIZE before its line ends, so diagnostics still come
+	// from the same lines; weighted vertices and 1D/3D texture coordinates keep using the single-element calls.
+	template <typename Consumer, typename Stream, typename = void>
+	struct accepts_batches : std::false_type
+	{
+	};
+
+	template <typename Consumer, typename Stream>
+	struct accepts_batches<Consumer, Stream, std::void_t<
+		decltype(std::declval<Consumer&>().consumeVertices(std::declval<Stream&>(), std::declval<const float3*>(), std::size_t())),
+		decltype(std::declval<Consumer&>().consumeNormals(std::declval<Stream&>(), std::declval<const float3*>(), std::size_t())),
+		decltype(std::declval<Consumer&>().consumeTexcoords(std::declval<Stream&>(), std::declval<const float2*>(), std::size_t())),
+		decltype(std::declval<Consumer&>().consumeFaceVertices(std::declval<Stream&>(), std::declval<const basic_face_vertex<consumer_index_t<Consumer>>*>(), int()))>> : std::true_type
+	{
+	};
+}
+
+#endif  // INCLUDED_OBJ_BATCH
@@ -0,0 +1,151 @@
+#ifndef INCLUDED_OBJ_BLOCK_STREAM
+#define INCLUDED_OBJ_BLOCK_STREAM
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include <parse/kernels.h>
+
+#include "obj_stream.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	// a BasicStream over input that is pulled from a ReadCallback one block at a time; only the complete lines in the
+	// buffer are parsed, the partial line at its end is moved to the front and completed by the next block, so the
+	// buffer only has to hold about two blocks, or the longest line. Names that statements hand to the consumer are
+	// only valid until it returns. Progress is not reported, as the length of the input is not known
+	template <typename Callback>
+	class BasicBlockStream : public BasicStream<Callback>
+	{
+		ReadCallback& input;
+		std::size_t block_size;
+		std::size_t capacity = 0;
+		std::unique_ptr<char[]> buffer;
+		char* data_end = nullptr;  // the input that has been read so far, lines are parsed up to the last newline before it
+		bool input_end = false;
+
+		// makes room for another block behind the data in the buffer
+		[[nodiscard]]
+		bool reserveBlock() noexcept
+		{
+			std::size_t size = data_end - buffer.get();
+
+			if (capacity - size >= block_size)
+				return true;
+
+			std::size_t new_capacity = capacity != 0 ? capacity : block_size;
+
+			while (new_capacity - size < block_size)
+				new_capacity *= 2;
+
+			auto grown = std::unique_ptr<char[]> { new (std::nothrow) char[new_capacity] };
+
+			if (!grown)
+				return false;
+
+			if (size != 0)
+				std::memcpy(&grown[0], &buffer[0], size);
+
+			buffer = std::move(grown);
+			capacity = new_capacity;
+			data_end = &buffer[0] + size;
+			return true;
+		}
+
+		// replaces the lines that have been parsed with the next ones; more is false at the end of the input
+		[[nodiscard]]
+		OBJ::error refill(bool& more) noexcept
+		{
+			// the lines that are dropped can no longer be counted when an error is reported
+			this->line += static_cast<std::int64_t>(parse::activeKernels().countNewlines(this->counted, this->end));
+
+			std::size_t carry = data_end - this->end;
+
+			if (carry != 0)
+				std::memmove(&buffer[0], this->end, carry);
+
+			data_end = buffer.get() + carry;
+
+			std::size_t window = 0;  // the complete lines at the front of the buffer
+
+			while (!input_end && window == 0)
+			{
+				if (!reserveBlock())
+					return OBJ::error::ALLOCATION_FAILED;
+
+				std::size_t block = data_end - &buffer[0];
+				std::ptrdiff_t n = input.read(data_end, block_size);
+
+				if (n < 0)
+					return OBJ::error::FAILED_TO_READ_FILE;
+
+				data_end += n;
+				input_end = n == 0;
+
+				// only the new block can have a newline, the carried over line has none
+				for (std::size_t p = block + n; p != block; --p)
+				{
+					if (buffer[p - 1] == '\n')
+					{
+						window = p;
+						break;
+					}
+				}
+			}
+
+			if (input_end)
+				window = data_end - buffer.get();
+
+			this->ptr = buffer.get();
+			this->end = buffer.get() + window;
+			this->next_progress = this->end;
+			this->counted = buffer.get();
+
+			more = this->ptr != this->end;
+			return OBJ::error::SUCCESS;
+		}
+
+	public:
+		using BasicStream<Callback>::consume;
+
+		BasicBlockStream(ReadCallback& input, std::size_t block_size, const char* name, Callback& callback) noexcept
+			: BasicStream<Callback>(nullptr, nullptr, name, callback), input(input), block_size(block_size != 0 ? block_size : 1)
+		{
+		}
+
+		template <typename Consumer>
+		[[nodiscard]]
+		OBJ::error consume(Consumer&& consumer) noexcept
+		{
+			for (;;)
+			{
+				bool more;
+
+				if (auto ret = refill(more); ret != OBJ::error::SUCCESS)
+					return ret;
+
+				if (!more)
+					break;
+
+				if (auto ret = this->consumeStatements(*this, consumer); ret != OBJ::error::SUCCESS)
+					return ret;
+			}
+
+			if (auto ret = consumer.finish(*this); ret != OBJ::error::SUCCESS)
+				return ret;
+
+			this->endFile();
+			return OBJ::error::SUCCESS;
+		}
+	};
+
+	using BlockStream = BasicBlockStream<StreamCallback>;
+}
+
+#endif  // INCLUDED_OBJ_BLOCK_STREAM
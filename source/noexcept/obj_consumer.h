@@ -0,0 +1,567 @@
+#ifndef INCLUDED_OBJ_CONSUMER
+#define INCLUDED_OBJ_CONSUMER
+
+#pragma once
+
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <optional>
+
+#include <parse/bits.h>
+
+#include "dynamic_array.h"
+#include "hash_map.h"
+
+#include "obj_stream.h"
+#include "obj_batch.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	// the indices of a face vertex that tell output vertices apart, leaving out those of attributes that are not read
+	template <Attributes A, typename Index = int>
+	struct vertex_key
+	{
+		static constexpr std::size_t size = 1 + reads(A, Attributes::NORMALS) + reads(A, Attributes::TEXCOORDS);
+
+		Index indices[size];
+
+		// how many bits every index gets in a packed key, which they only fit into if they are not negative
+		static constexpr int packed_bits = 64 / size;
+		static constexpr std::uint64_t packed_mask = ~std::uint64_t(0) >> (64 - packed_bits);
+
+		static vertex_key make(Index v, Index n, Index t) noexcept
+		{
+			vertex_key key = { { v } };
+			std::size_t i = 1;
+
+			if constexpr (reads(A, Attributes::NORMALS))
+				key.indices[i++] = n;
+
+			if constexpr (reads(A, Attributes::TEXCOORDS))
+				key.indices[i++] = t;
+
+			return key;
+		}
+
+		// whether the indices fit into a 64-bit key, which they always do if they are small enough to be packed as they are
+		bool packable() const noexcept
+		{
+			if constexpr (packed_bits < 8 * sizeof(Index))
+			{
+				for (std::size_t i = 0; i < size; ++i)
+					if (static_cast<std::make_unsigned_t<Index>>(indices[i]) > packed_mask)
+						return false;
+			}
+			return true;
+		}
+
+		std::uint64_t pack() const noexcept
+		{
+			std::uint64_t key = 0;
+
+			for (std::size_t i = 0; i < size; ++i)
+				key |= (static_cast<std::make_unsigned_t<Index>>(indices[i]) & packed_mask) << (i * packed_bits);
+
+			return key;
+		}
+
+		static vertex_key unpack(std::uint64_t packed) noexcept
+		{
+			vertex_key key;
+
+			for (std::size_t i = 0; i < size; ++i)
+				key.indices[i] = static_cast<Index>(static_cast<std::make_unsigned_t<Index>>((packed >> (i * packed_bits)) & packed_mask));
+
+			return key;
+		}
+
+		friend bool operator ==(const vertex_key& a, const vertex_key& b) noexcept
+		{
+			for (std::size_t i = 0; i < size; ++i)
+				if (a.indices[i] != b.indices[i])
+					return false;
+			return true;
+		}
+	};
+
+	// hashes vertex keys and packed ones with multiply-xorshift rounds, which leave every bit of the hash depending on
+	// every bit of the key; starting from a seed that is picked at random for a load keeps files that were crafted to
+	// make the keys of a known hash collide from doing so
+	struct vertex_key_hash
+	{
+		using is_avalanching = void;
+
+		std::uint64_t seed = 0;
+
+		static std::uint64_t mix(std::uint64_t h) noexcept
+		{
+			h ^= h >> 32;
+			h *= 0xD6E8FEB86659FD93ULL;
+			h ^= h >> 32;
+			h *= 0xD6E8FEB86659FD93ULL;
+			return h ^ (h >> 32);
+		}
+
+		std::size_t operator ()(std::uint64_t packed) const noexcept
+		{
+			return static_cast<std::size_t>(mix(packed ^ seed));
+		}
+
+		template <Attributes A, typename Index>
+		std::size_t operator ()(const vertex_key<A, Index>& key) const noexcept
+		{
+			std::uint64_t h = seed;
+
+			for (std::size_t i = 0; i < vertex_key<A, Index>::size; ++i)
+				h = mix(h ^ static_cast<std::uint64_t>(key.indices[i]));
+
+			return static_cast<std::size_t>(h);
+		}
+	};
+
+
+	// collects the triangles of an OBJ file, keeping only the vertex attributes A besides positions; Index has to be
+	// wide enough for the number of vertices, which int is unless the input is larger than needsWideIndices allows
+	template <Attributes A, typename Index = int>
+	class BasicOBJConsumer
+	{
+	protected:
+		static constexpr bool reads_normals = reads(A, Attributes::NORMALS);
+		static constexpr bool reads_texcoords = reads(A, Attributes::TEXCOORDS);
+
+		dynamic_array<float3> v;
+		dynamic_array<float3> vn;
+		dynamic_array<float2> vt;
+
+		// face vertices are looked up by their keys packed into 64 bits until one of them does not fit, from then on
+		// all of them are looked up by their keys as they are
+		hash_map<std::uint64_t, Index, vertex_key_hash> packed_vertex_map;
+		hash_map<vertex_key<A, Index>, Index, vertex_key_hash> vertex_map;
+		bool packed_keys = true;
+
+		dynamic_array<float3> positions;
+		dynamic_array<float3> normals;
+		dynamic_array<float2> texcoords;
+		dynamic_array<std::array<Index, 3>> triangles;
+
+		static constexpr int MAX_FACE_VERTICES = 7;
+
+		// face vertices are merged in batches of about this many, once their faces are complete, so that the memory
+		// accesses of all their lookups can be under way at the same time
+		static constexpr int FACE_VERTEX_BATCH_SIZE = 64;
+
+		// the face vertices of the face that is being read and of the faces that are waiting to be merged, with their
+		// relative indices already resolved
+		basic_face_vertex<Index> face_vertices[MAX_FACE_VERTICES];
+		int num_face_vertices = 0;
+
+		basic_face_vertex<Index> pending_face_vertices[FACE_VERTEX_BATCH_SIZE + MAX_FACE_VERTICES - 1];
+		std::uint8_t pending_face_sizes[FACE_VERTEX_BATCH_SIZE];
+		int num_pending_face_vertices = 0;
+		int num_pending_faces = 0;
+
+		template <typename Stream>
+		[[nodiscard]]
+		static bool checkFaceVertexCount(Stream& stream, int num_face_vertices) noexcept
+		{
+			if (num_face_vertices >= MAX_FACE_VERTICES)
+			{
+				stream.error("this face has too many vertices");
+				return false;
+			}
+			return true;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		static bool checkFaceSize(Stream& stream, int num_face_vertices) noexcept
+		{
+			if (num_face_vertices < 3)
+			{
+				stream.error("face must have at least three vertices");
+				return false;
+			}
+			return true;
+		}
+
+		[[nodiscard]]
+		bool unpackKeys() noexcept
+		{
+			if (!vertex_map.reserve(packed_vertex_map.size() + 1))
+				return false;
+
+			// there is room for all of them, so none of the insertions can fail
+			packed_vertex_map.forEach([&](const auto& vertex) noexcept { (void)vertex_map.try_emplace(vertex_key<A, Index>::unpack(vertex.first), vertex.second); });
+
+			packed_vertex_map = {};
+			packed_keys = false;
+			return true;
+		}
+
+		// the face vertex with its indices relative to the attributes read so far turned into ones that index v, vn and vt
+		basic_face_vertex<Index> resolveFaceVertex(Index vi, Index ni, Index ti) const noexcept
+		{
+			if (vi < 0)
+				vi = static_cast<Index>(size(v)) + vi;
+			else
+				--vi;
+
+			if (reads_normals && ni < 0)
+				ni = static_cast<Index>(size(vn)) + ni;
+
+			if (reads_texcoords && ti < 0)
+				ti = static_cast<Index>(size(vt)) + ti;
+
+			return { vi, ni, ti };
+		}
+
+		template <typename T>
+		static void prefetchAttribute(const dynamic_array<T>& attributes, Index i) noexcept
+		{
+			if (static_cast<std::make_unsigned_t<Index>>(i) < size(attributes))
+				parse::prefetch(&attributes[i]);
+		}
+
+		// merges the pending face vertices through map, which takes the keys that make_key turns them into, in three
+		// passes that each only touch memory the one before asked for: the groups their lookups start at and the
+		// attributes they would copy, then the slots in these groups they would end at, then the lookups themselves
+		template <typename Map, typename MakeKey>
+		[[nodiscard]]
+		bool mergeFaceVertices(Map& map, MakeKey&& make_key, Index* merged) noexcept
+		{
+			int count = num_pending_face_vertices;
+			std::uint64_t hashes[FACE_VERTEX_BATCH_SIZE + MAX_FACE_VERTICES - 1];
+
+			// growing the table halfway through would lose what was prefetched
+			if (!map.reserve(map.size() + count))
+				return false;
+
+			for (int i = 0; i < count; ++i)
+			{
+				const auto& fv = pending_face_vertices[i];
+
+				hashes[i] = map.hashOf(make_key(fv));
+				map.prefetchGroup(hashes[i]);
+
+				prefetchAttribute(v, fv.v);
+
+				if constexpr (reads_normals)
+					prefetchAttribute(vn, fv.n);
+
+				if constexpr (reads_texcoords)
+					prefetchAttribute(vt, fv.t);
+			}
+
+			for (int i = 0; i < count; ++i)
+				map.prefetchSlot(hashes[i]);
+
+			for (int i = 0; i < count; ++i)
+			{
+				const auto& fv = pending_face_vertices[i];
+				auto vertex = map.try_emplace_hashed(hashes[i], make_key(fv), static_cast<Index>(size(positions)));
+
+				if (!vertex)
+					return false;
+
+				if (vertex->second)
+				{
+					if (!positions.push_back(v[fv.v]))
+						return false;
+
+					if constexpr (reads_normals)
+					{
+						if (auto n = fv.n == 0 ? float3 { 0.0f, 0.0f, 0.0f } : vn[fv.n]; !normals.push_back(n))
+							return false;
+					}
+
+					if constexpr (reads_texcoords)
+					{
+						if (auto t = fv.t == 0 ? float2 { 0.0f, 0.0f } : vt[fv.t]; !texcoords.push_back(t))
+							return false;
+					}
+				}
+
+				merged[i] = vertex->first->second;
+			}
+
+			return true;
+		}
+
+	public:
+		static constexpr Attributes attributes = A;
+		using index_type = Index;
+
+		BasicOBJConsumer() = default;
+
+		// hash_seed is mixed into the hashes of the face vertices, see vertex_key_hash
+		explicit BasicOBJConsumer(std::uint64_t hash_seed) noexcept
+			: packed_vertex_map(vertex_key_hash { hash_seed }), vertex_map(vertex_key_hash { hash_seed })
+		{
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeVertex(Stream& stream, float x, float y, float z) noexcept
+		{
+			if (!v.emplace_back(x, y, z))
+				return OBJ::error::ALLOCATION_FAILED;
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeVertices(Stream& stream, const float3* vertices, std::size_t count) noexcept
+		{
+			if (!v.append(vertices, vertices + count))
+				return OBJ::error::ALLOCATION_FAILED;
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeVertex(Stream& stream, float x, float y, float z, float w) noexcept
+		{
+			stream.error("weighted vertex coordinates are not supported");
+			return OBJ::error::UNSUPPORTED_FEATURE;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeNormal(Stream& stream, float x, float y, float z) noexcept
+		{
+			if (!vn.emplace_back(x, y, z))
+				return OBJ::error::ALLOCATION_FAILED;
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeNormals(Stream& stream, const float3* normals, std::size_t count) noexcept
+		{
+			if (!vn.append(normals, normals + count))
+				return OBJ::error::ALLOCATION_FAILED;
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeTexcoord(Stream& stream, float u) noexcept
+		{
+			stream.error("1D texture coordinates are not supported");
+			return OBJ::error::UNSUPPORTED_FEATURE;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeTexcoord(Stream& stream, float u, float v) noexcept
+		{
+			if (!vt.emplace_back(u, 1.0f - v))
+				return OBJ::error::ALLOCATION_FAILED;
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeTexcoords(Stream& stream, const float2* texcoords, std::size_t count) noexcept
+		{
+			auto first = size(vt);
+
+			if (!vt.append(texcoords, texcoords + count))
+				return OBJ::error::ALLOCATION_FAILED;
+
+			for (auto i = first; i < size(vt); ++i)
+				vt[i].y = 1.0f - vt[i].y;
+
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeTexcoord(Stream& stream, float u, float v, float w) noexcept
+		{
+			stream.error("3D texture coordinates are not supported");
+			return OBJ::error::UNSUPPORTED_FEATURE;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeFaceVertex(Stream& stream, Index vi, Index ni, Index ti) noexcept
+		{
+			if (!checkFaceVertexCount(stream, num_face_vertices))
+				return OBJ::error::SYNTAX_ERROR;
+			face_vertices[num_face_vertices++] = resolveFaceVertex(vi, ni, ti);
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeFaceVertices(Stream& stream, const basic_face_vertex<Index>* vertices, int count) noexcept
+		{
+			// the face is rejected as a whole if it gets too many vertices, so the check can be done once up front
+			if (!checkFaceVertexCount(stream, num_face_vertices + count - 1))
+				return OBJ::error::SYNTAX_ERROR;
+
+			for (int i = 0; i < count; ++i)
+				face_vertices[num_face_vertices + i] = resolveFaceVertex(vertices[i].v, vertices[i].n, vertices[i].t);
+
+			num_face_vertices += count;
+
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error finishFace(Stream& stream) noexcept
+		{
+			if (!checkFaceSize(stream, num_face_vertices))
+				return OBJ::error::SYNTAX_ERROR;
+
+			std::copy(face_vertices, face_vertices + num_face_vertices, pending_face_vertices + num_pending_face_vertices);
+			num_pending_face_vertices += num_face_vertices;
+
+			pending_face_sizes[num_pending_faces++] = static_cast<std::uint8_t>(num_face_vertices);
+			num_face_vertices = 0;
+
+			if (num_pending_face_vertices >= FACE_VERTEX_BATCH_SIZE)
+				return mergeFaces();
+
+			return OBJ::error::SUCCESS;
+		}
+
+		// merges the vertices of the faces that have been read and adds their triangles; the output vertices and triangles
+		// are only complete after this, which finish cannot do as it cannot fail
+		[[nodiscard]]
+		OBJ::error mergeFaces() noexcept
+		{
+			if (num_pending_faces == 0)
+				return OBJ::error::SUCCESS;
+
+			if (packed_keys)
+			{
+				for (int i = 0; i < num_pending_face_vertices; ++i)
+				{
+					const auto& fv = pending_face_vertices[i];
+
+					if (!vertex_key<A, Index>::make(fv.v, fv.n, fv.t).packable())
+					{
+						if (!unpackKeys())
+							return OBJ::error::ALLOCATION_FAILED;
+						break;
+					}
+				}
+			}
+
+			Index merged[FACE_VERTEX_BATCH_SIZE + MAX_FACE_VERTICES - 1];
+
+			if (packed_keys)
+			{
+				if (!mergeFaceVertices(packed_vertex_map, [](const basic_face_vertex<Index>& fv) noexcept { return vertex_key<A, Index>::make(fv.v, fv.n, fv.t).pack(); }, merged))
+					return OBJ::error::ALLOCATION_FAILED;
+			}
+			else
+			{
+				if (!mergeFaceVertices(vertex_map, [](const basic_face_vertex<Index>& fv) noexcept { return vertex_key<A, Index>::make(fv.v, fv.n, fv.t); }, merged))
+					return OBJ::error::ALLOCATION_FAILED;
+			}
+
+			const Index* face = merged;
+			for (int f = 0; f < num_pending_faces; ++f)
+			{
+				for (int i = 2; i < pending_face_sizes[f]; ++i)
+					if (!triangles.push_back({ face[0], face[i - 1], face[i] }))
+						return OBJ::error::ALLOCATION_FAILED;
+
+				face += pending_face_sizes[f];
+			}
+
+			num_pending_face_vertices = 0;
+			num_pending_faces = 0;
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		OBJ::error consumeObjectName(Stream& stream, std::string_view name) noexcept
+		{
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		OBJ::error consumeGroupName(Stream& stream, std::string_view name) noexcept
+		{
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		OBJ::error finishGroupAssignment(Stream& streame) noexcept
+		{
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeSmoothingGroup(Stream& stream, int n) noexcept
+		{
+			stream.warn("smoothing groups are ignored!");
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeMtlLib(Stream& stream, std::string_view name) noexcept
+		{
+			stream.warn("materials are ignored!");
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename Stream>
+		[[nodiscard]]
+		OBJ::error consumeUseMtl(Stream& stream, std::string_view name) noexcept
+		{
+			stream.warn("materials are ignored!");
+			return OBJ::error::SUCCESS;
+		}
+
+		// makes room for num_vertices output vertices, so that merging face vertices does not have to grow the table
+		// until there are more
+		[[nodiscard]]
+		OBJ::error reserveVertices(std::size_t num_vertices) noexcept
+		{
+			if (!(packed_keys ? packed_vertex_map.reserve(num_vertices) : vertex_map.reserve(num_vertices)))
+				return OBJ::error::ALLOCATION_FAILED;
+			return OBJ::error::SUCCESS;
+		}
+
+		// takes over the vertex attributes collected by another consumer, as if they had been consumed by this one
+		[[nodiscard]]
+		OBJ::error appendAttributes(BasicOBJConsumer&& other) noexcept
+		{
+			if (!v.append(other.v.begin(), other.v.end()) || !vn.append(other.vn.begin(), other.vn.end()) || !vt.append(other.vt.begin(), other.vt.end()))
+				return OBJ::error::ALLOCATION_FAILED;
+			return OBJ::error::SUCCESS;
+		}
+
+		OBJ::BasicTriangles<A, Index> finish() noexcept
+		{
+			OBJ::BasicTriangles<A, Index> out;
+
+			out.positions = std::move(positions);
+
+			if constexpr (reads_normals)
+				out.normals = std::move(normals);
+
+			if constexpr (reads_texcoords)
+				out.texcoords = std::move(texcoords);
+
+			out.triangles = std::move(triangles);
+			return out;
+		}
+	};
+
+	using OBJConsumer = BasicOBJConsumer<Attributes::ALL>;
+}
+
+#endif  // INCLUDED_OBJ_CONSUMER
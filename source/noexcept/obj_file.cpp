@@ -0,0 +1,705 @@
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <cerrno>
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <iterator>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+#endif
+
+#include "obj_file.h"
+
+
+namespace
+{
+	// the size of the buffer that files are read into at first when it is not known how large they are
+	constexpr std::size_t MIN_READ_BUFFER_SIZE = 1 << 16;
+
+	// the blocks a ReadAheadFile cycles through: one being parsed, one being read and one in between for the
+	// times either side is slower
+	constexpr int NUM_READ_AHEAD_BLOCKS = 3;
+
+	// how often either side of a ReadAheadFile checks for the other before it goes to sleep
+	constexpr int SPIN_COUNT = 64;
+
+	// how often a FileWatch looks at the file where the system cannot tell it about changes
+	constexpr std::chrono::milliseconds POLL_INTERVAL { 50 };
+
+#if defined(_WIN32)
+	struct File
+	{
+		HANDLE handle;
+
+		explicit File(const char* path) noexcept
+			: handle(CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr))
+		{
+		}
+
+		~File()
+		{
+			if (handle != INVALID_HANDLE_VALUE)
+				CloseHandle(handle);
+		}
+
+		File(const File&) = delete;
+		File& operator =(const File&) = delete;
+
+		bool isOpen() const noexcept
+		{
+			return handle != INVALID_HANDLE_VALUE;
+		}
+
+		// the size of the file if it is one that can be mapped, 0 otherwise
+		std::size_t mappableSize() const noexcept
+		{
+			LARGE_INTEGER size;
+			if (GetFileType(handle) != FILE_TYPE_DISK || !GetFileSizeEx(handle, &size))
+				return 0;
+			return static_cast<std::size_t>(size.QuadPart);
+		}
+
+		const char* map(std::size_t size, OBJ::FileAccess access) const noexcept
+		{
+			HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+			if (!mapping)
+				return nullptr;
+
+			// the view keeps the mapping alive
+			void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+			CloseHandle(mapping);
+
+#if defined(_WIN32_WINNT_WIN8) && _WIN32_WINNT >= _WIN32_WINNT_WIN8
+			if (data && access == OBJ::FileAccess::POPULATE)
+			{
+				WIN32_MEMORY_RANGE_ENTRY range = { data, size };
+				PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+			}
+#endif
+
+			return static_cast<const char*>(data);
+		}
+
+		void adviseSequential() const noexcept
+		{
+			// the file was opened with FILE_FLAG_SEQUENTIAL_SCAN
+		}
+
+		std::uint64_t identity() const noexcept
+		{
+			BY_HANDLE_FILE_INFORMATION info;
+			if (!GetFileInformationByHandle(handle, &info))
+				return 0;
+			return (static_cast<std::uint64_t>(info.nFileIndexHigh) << 32 | info.nFileIndexLow) ^ (static_cast<std::uint64_t>(info.dwVolumeSerialNumber) << 40);
+		}
+
+		static void unmap(const char* data, std::size_t size) noexcept
+		{
+			UnmapViewOfFile(data);
+		}
+
+		// reads from offset if the file is seekable, from wherever the last read stopped otherwise; returns -1 if reading failed
+		std::ptrdiff_t read(char* buffer, std::size_t size, std::uint64_t offset, bool seekable) const noexcept
+		{
+			OVERLAPPED position = {};
+			position.Offset = static_cast<DWORD>(offset);
+			position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+			DWORD read;
+			if (!ReadFile(handle, buffer, static_cast<DWORD>(size < MAXDWORD ? size : MAXDWORD), &read, seekable ? &position : nullptr))
+			{
+				// the write end of a pipe being closed is how pipes end
+				return GetLastError() == ERROR_BROKEN_PIPE || GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+			}
+			return read;
+		}
+	};
+#else
+	struct File
+	{
+		int fd;
+
+		explicit File(const char* path) noexcept
+			: fd(open(path, O_RDONLY | O_CLOEXEC))
+		{
+		}
+
+		~File()
+		{
+			if (fd >= 0)
+				close(fd);
+		}
+
+		File(const File&) = delete;
+		File& operator =(const File&) = delete;
+
+		bool isOpen() const noexcept
+		{
+			return fd >= 0;
+		}
+
+		// the size of the file if it is one that can be mapped, 0 otherwise
+		std::size_t mappableSize() const noexcept
+		{
+			struct stat info;
+			if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+				return 0;
+			return static_cast<std::size_t>(info.st_size);
+		}
+
+		const char* map(std::size_t size, OBJ::FileAccess access) const noexcept
+		{
+			int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+			if (access == OBJ::FileAccess::POPULATE)
+				flags |= MAP_POPULATE;
+#endif
+
+			void* data = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+
+			if (data == MAP_FAILED)
+				return nullptr;
+
+			// the file is parsed front to back, pages behind the parser can go as soon as the system needs them
+			madvise(data, size, MADV_SEQUENTIAL);
+			madvise(data, size, MADV_WILLNEED);
+#if defined(MADV_HUGEPAGE)
+			if (access == OBJ::FileAccess::POPULATE)
+				madvise(data, size, MADV_HUGEPAGE);
+#endif
+
+			return static_cast<const char*>(data);
+		}
+
+		void adviseSequential() const noexcept
+		{
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		}
+
+		std::uint64_t identity() const noexcept
+		{
+			struct stat info;
+			if (fstat(fd, &info) != 0)
+				return 0;
+			return static_cast<std::uint64_t>(info.st_ino) ^ (static_cast<std::uint64_t>(info.st_dev) << 40);
+		}
+
+		static void unmap(const char* data, std::size_t size) noexcept
+		{
+			munmap(const_cast<char*>(data), size);
+		}
+
+		// reads from offset if the file is seekable, from wherever the last read stopped otherwise; returns -1 if reading failed
+		std::ptrdiff_t read(char* buffer, std::size_t size, std::uint64_t offset, bool seekable) const noexcept
+		{
+			for (;;)
+			{
+				if (auto n = seekable ? pread(fd, buffer, size, static_cast<off_t>(offset)) : ::read(fd, buffer, size); n >= 0 || errno != EINTR)
+					return n;
+			}
+		}
+	};
+#endif
+
+	// copies the file from offset to its end into buffer, which it grows as needed, and sets size to how much that was;
+	// expected_size is what the file is supposed to have from offset on, 0 if that is not known. Reading from the start
+	// does not seek, which pipes cannot
+	[[nodiscard]]
+	OBJ::error readToEnd(const File& file, std::uint64_t offset, std::size_t expected_size, std::unique_ptr<char[]>& buffer, std::size_t& size) noexcept
+	{
+		// reading one byte more than the file is supposed to have finds its end without having to grow the buffer
+		std::size_t capacity = expected_size < MIN_READ_BUFFER_SIZE ? MIN_READ_BUFFER_SIZE : expected_size + 1;
+		size = 0;
+		buffer.reset(new (std::nothrow) char[capacity]);
+
+		if (!buffer)
+			return OBJ::error::ALLOCATION_FAILED;
+
+		for (;;)
+		{
+			auto n = file.read(&buffer[size], capacity - size, offset + size, offset != 0);
+
+			if (n < 0)
+				return OBJ::error::FAILED_TO_READ_FILE;
+
+			if (n == 0)
+				return OBJ::error::SUCCESS;
+
+			size += static_cast<std::size_t>(n);
+
+			if (size == capacity)
+			{
+				auto grown = std::unique_ptr<char[]> { new (std::nothrow) char[capacity * 2] };
+
+				if (!grown)
+					return OBJ::error::ALLOCATION_FAILED;
+
+				std::memcpy(&grown[0], &buffer[0], size);
+				buffer = std::move(grown);
+				capacity *= 2;
+			}
+		}
+	}
+
+	// a copy of a string that cannot throw
+	std::unique_ptr<char[]> copyString(const char* begin, const char* end) noexcept
+	{
+		std::unique_ptr<char[]> copy { new (std::nothrow) char[end - begin + 1] };
+
+		if (copy)
+		{
+			std::memcpy(&copy[0], begin, end - begin);
+			copy[end - begin] = '\0';
+		}
+
+		return copy;
+	}
+}
+
+namespace OBJ
+{
+	error InputFile::open(const char* path, FileAccess access) noexcept
+	{
+		File file(path);
+
+		if (!file.isOpen())
+			return error::FAILED_TO_OPEN_FILE;
+
+		auto file_size = file.mappableSize();
+
+		if (access != FileAccess::READ && file_size != 0)
+		{
+			if (auto mapping = file.map(file_size, access))
+			{
+				data = mapping;
+				size = file_size;
+				mapped = true;
+				return error::SUCCESS;
+			}
+		}
+
+		if (error err = readToEnd(file, 0, file_size, buffer, size); err != error::SUCCESS)
+			return err;
+
+		data = &buffer[0];
+		return error::SUCCESS;
+	}
+
+	InputFile::~InputFile()
+	{
+		if (mapped)
+			File::unmap(data, size);
+	}
+
+	error FileTail::open(const char* path, std::uint64_t offset) noexcept
+	{
+		File file(path);
+
+		if (!file.isOpen())
+			return error::FAILED_TO_OPEN_FILE;
+
+		file_id = file.identity();
+		file_size = file.mappableSize();
+
+		// files that cannot be mapped cannot be read from an offset either, they only ever have a start
+		if (file_size < offset || (file_size == 0 && offset != 0))
+		{
+			buffer.reset(new (std::nothrow) char[1]);
+			size = 0;
+			return buffer ? error::SUCCESS : error::ALLOCATION_FAILED;
+		}
+
+		if (error err = readToEnd(file, offset, static_cast<std::size_t>(file_size - offset), buffer, size); err != error::SUCCESS)
+			return err;
+
+		file_size = offset + size;
+		return error::SUCCESS;
+	}
+
+#if defined(__linux__)
+	// watches the directory of the file rather than the file itself, which saving another one over it would end
+	class FileWatch::Watch
+	{
+		int fd = -1;
+		std::unique_ptr<char[]> name;
+
+	public:
+		~Watch()
+		{
+			if (fd >= 0)
+				close(fd);
+		}
+
+		[[nodiscard]]
+		error open(const char* path) noexcept
+		{
+			auto path_end = path + std::strlen(path);
+			auto separator = std::find(std::make_reverse_iterator(path_end), std::make_reverse_iterator(path), '/').base();
+
+			name = copyString(separator, path_end);
+			auto directory = separator == path ? copyString(".", "." + 1) : copyString(path, separator);
+
+			if (!name || !directory)
+				return error::ALLOCATION_FAILED;
+
+			fd = inotify_init1(IN_CLOEXEC);
+
+			if (fd < 0 || inotify_add_watch(fd, &directory[0], IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_ATTRIB) < 0)
+				return error::FAILED_TO_OPEN_FILE;
+
+			return error::SUCCESS;
+		}
+
+		bool wait(std::chrono::milliseconds timeout) noexcept
+		{
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+
+			for (;;)
+			{
+				auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+				pollfd events = { fd, POLLIN, 0 };
+
+				if (int ret = poll(&events, 1, left > 0 ? static_cast<int>(left) : 0); ret <= 0)
+				{
+					if (ret < 0 && errno == EINTR)
+						continue;
+					return false;
+				}
+
+				alignas(inotify_event) char buffer[4096];
+				auto n = ::read(fd, buffer, sizeof(buffer));
+
+				if (n <= 0)
+					return false;
+
+				bool changed = false;
+
+				for (char* p = buffer; p < buffer + n; )
+				{
+					auto event = reinterpret_cast<const inotify_event*>(p);
+
+					if (event->len != 0 && std::strcmp(&name[0], event->name) == 0)
+						changed = true;
+
+					p += sizeof(inotify_event) + event->len;
+				}
+
+				if (changed)
+					return true;
+			}
+		}
+	};
+#else
+	class FileWatch::Watch
+	{
+		std::unique_ptr<char[]> path;
+		std::uint64_t size = 0;
+		std::uint64_t time = 0;
+
+		bool changed() noexcept
+		{
+			std::uint64_t new_size = 0;
+			std::uint64_t new_time = 0;
+
+#if defined(_WIN32)
+			if (WIN32_FILE_ATTRIBUTE_DATA info; GetFileAttributesExA(&path[0], GetFileExInfoStandard, &info))
+			{
+				new_size = static_cast<std::uint64_t>(info.nFileSizeHigh) << 32 | info.nFileSizeLow;
+				new_time = static_cast<std::uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32 | info.ftLastWriteTime.dwLowDateTime;
+			}
+#else
+			if (struct stat info; stat(&path[0], &info) == 0)
+			{
+				new_size = static_cast<std::uint64_t>(info.st_size);
+				new_time = static_cast<std::uint64_t>(info.st_mtime);
+			}
+#endif
+
+			if (new_size == size && new_time == time)
+				return false;
+
+			size = new_size;
+			time = new_time;
+			return true;
+		}
+
+	public:
+		[[nodiscard]]
+		error open(const char* path) noexcept
+		{
+			this->path = copyString(path, path + std::strlen(path));
+
+			if (!this->path)
+				return error::ALLOCATION_FAILED;
+
+			changed();
+			return error::SUCCESS;
+		}
+
+		bool wait(std::chrono::milliseconds timeout) noexcept
+		{
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+
+			while (!changed())
+			{
+				if (std::chrono::steady_clock::now() >= deadline)
+					return false;
+
+				std::this_thread::sleep_for(POLL_INTERVAL);
+			}
+
+			return true;
+		}
+	};
+#endif
+
+	FileWatch::FileWatch() noexcept = default;
+
+	FileWatch::~FileWatch() = default;
+
+	error FileWatch::open(const char* path) noexcept
+	{
+		watch.reset(new (std::nothrow) Watch());
+
+		if (!watch)
+			return error::ALLOCATION_FAILED;
+
+		return watch->open(path);
+	}
+
+	bool FileWatch::wait(std::chrono::milliseconds timeout) noexcept
+	{
+		return watch->wait(timeout);
+	}
+
+	// the reading thread fills the blocks in turn and publishes them through filled, the parsing one hands them back
+	// through released; the mutex is only taken to sleep when one side is waiting for the other
+	class ReadAhead::Pipeline
+	{
+		struct block
+		{
+			std::unique_ptr<char[]> data;
+			std::size_t size;  // 0 marks the end of the input
+		};
+
+		GzipReadCallback input;
+		std::size_t block_size;
+		block blocks[NUM_READ_AHEAD_BLOCKS];
+
+		std::atomic<std::size_t> filled { 0 };
+		std::atomic<std::size_t> released { 0 };
+		std::atomic<bool> failed { false };
+		std::atomic<bool> stopped { false };
+
+		std::atomic<int> sleepers { 0 };
+		std::mutex mutex;
+		std::condition_variable wakeup;
+
+		std::size_t next = 0;    // the block the parser takes from next
+		std::size_t offset = 0;  // how much of it has been taken
+
+		std::thread reader;
+
+		template <typename Ready>
+		void wait(Ready&& ready) noexcept
+		{
+			for (int i = 0; i < SPIN_COUNT; ++i)
+				if (ready())
+					return;
+
+			std::unique_lock lock(mutex);
+			++sleepers;
+			wakeup.wait(lock, ready);
+			--sleepers;
+		}
+
+		void notify() noexcept
+		{
+			if (sleepers != 0)
+			{
+				std::lock_guard lock(mutex);
+				wakeup.notify_all();
+			}
+		}
+
+		void readAhead() noexcept
+		{
+			for (std::size_t i = 0; ; ++i)
+			{
+				wait([&] { return i - released < NUM_READ_AHEAD_BLOCKS || stopped; });
+
+				if (stopped)
+					return;
+
+				auto& b = blocks[i % NUM_READ_AHEAD_BLOCKS];
+				auto n = input.read(&b.data[0], block_size);
+
+				if (n < 0)
+					failed = true;
+
+				b.size = n > 0 ? static_cast<std::size_t>(n) : 0;
+
+				filled = i + 1;
+				notify();
+
+				if (b.size == 0)
+					return;
+			}
+		}
+
+	public:
+		Pipeline(ReadCallback& source, std::size_t block_size) noexcept
+			: input(source), block_size(block_size != 0 ? block_size : 1)
+		{
+		}
+
+		[[nodiscard]]
+		error start() noexcept
+		{
+			for (auto& b : blocks)
+			{
+				b.data.reset(new (std::nothrow) char[block_size]);
+
+				if (!b.data)
+					return error::ALLOCATION_FAILED;
+			}
+
+			reader = std::thread([this] { readAhead(); });
+			return error::SUCCESS;
+		}
+
+		~Pipeline()
+		{
+			if (!reader.joinable())
+				return;
+
+			stopped = true;
+
+			{
+				std::lock_guard lock(mutex);
+				wakeup.notify_all();
+			}
+
+			reader.join();
+		}
+
+		std::ptrdiff_t read(char* buffer, std::size_t size) noexcept
+		{
+			wait([&] { return filled > next; });
+
+			auto& b = blocks[next % NUM_READ_AHEAD_BLOCKS];
+
+			if (b.size == 0)
+			{
+				return failed ? -1 : 0;
+			}
+
+			auto n = std::min(size, b.size - offset);
+			std::memcpy(buffer, &b.data[offset], n);
+			offset += n;
+
+			if (offset == b.size)
+			{
+				offset = 0;
+				released = ++next;
+				notify();
+			}
+
+			return static_cast<std::ptrdiff_t>(n);
+		}
+	};
+
+	ReadAhead::ReadAhead() noexcept = default;
+
+	ReadAhead::~ReadAhead() = default;
+
+	error ReadAhead::start(ReadCallback& source, std::size_t block_size) noexcept
+	{
+		pipeline.reset(new (std::nothrow) Pipeline(source, block_size));
+
+		if (!pipeline)
+			return error::ALLOCATION_FAILED;
+
+		return pipeline->start();
+	}
+
+	std::ptrdiff_t ReadAhead::read(char* buffer, std::size_t size) noexcept
+	{
+		return pipeline->read(buffer, size);
+	}
+
+	// reads at explicit offsets where the file is seekable, so that nothing else can move it
+	class ReadAheadFile::Source : public ReadCallback
+	{
+		File file;
+		bool seekable = false;
+		std::uint64_t position = 0;
+
+	public:
+		explicit Source(const char* path) noexcept
+			: file(path)
+		{
+		}
+
+		[[nodiscard]]
+		error open() noexcept
+		{
+			if (!file.isOpen())
+				return error::FAILED_TO_OPEN_FILE;
+
+			seekable = file.mappableSize() != 0;
+			file.adviseSequential();
+			return error::SUCCESS;
+		}
+
+		std::ptrdiff_t read(char* buffer, std::size_t size) noexcept override
+		{
+			auto n = file.read(buffer, size, position, seekable);
+
+			if (n > 0)
+				position += static_cast<std::size_t>(n);
+
+			return n;
+		}
+	};
+
+	ReadAheadFile::ReadAheadFile() noexcept = default;
+
+	ReadAheadFile::~ReadAheadFile() = default;
+
+	error ReadAheadFile::open(const char* path, std::size_t block_size) noexcept
+	{
+		source.reset(new (std::nothrow) Source(path));
+
+		if (!source)
+			return error::ALLOCATION_FAILED;
+
+		if (error err = source->open(); err != error::SUCCESS)
+			return err;
+
+		return input.start(*source, block_size);
+	}
+
+	std::ptrdiff_t ReadAheadFile::read(char* buffer, std::size_t size) noexcept
+	{
+		return input.read(buffer, size);
+	}
+}
@@ -0,0 +1,122 @@
+#ifndef INCLUDED_OBJ_FILE
+#define INCLUDED_OBJ_FILE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <chrono>
+
+#include "obj_gzip.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	// the contents of a file, mapped into memory so that parsing can start before all of it has been read, or copied
+	// into a buffer if access is READ or the file cannot be mapped, like pipes and other files that are not regular
+	class InputFile
+	{
+		std::unique_ptr<char[]> buffer;
+		const char* data = nullptr;
+		std::size_t size = 0;
+		bool mapped = false;
+
+	public:
+		InputFile() = default;
+		~InputFile();
+
+		InputFile(const InputFile&) = delete;
+		InputFile& operator =(const InputFile&) = delete;
+
+		// has to succeed before begin and end are called
+		[[nodiscard]]
+		error open(const char* path, FileAccess access) noexcept;
+
+		const char* begin() const noexcept { return data; }
+		const char* end() const noexcept { return data + size; }
+
+		bool compressed() const noexcept { return isGzip(begin(), end()); }
+	};
+
+	// the part of a file from offset to its end, copied into memory, for following files that grow
+	class FileTail
+	{
+		std::unique_ptr<char[]> buffer;
+		std::size_t size = 0;
+		std::uint64_t file_id = 0;
+		std::uint64_t file_size = 0;
+
+	public:
+		FileTail() = default;
+
+		// has to succeed before the rest is called; reads nothing if the file has become shorter than offset
+		[[nodiscard]]
+		error open(const char* path, std::uint64_t offset) noexcept;
+
+		const char* begin() const noexcept { return &buffer[0]; }
+		const char* end() const noexcept { return &buffer[0] + size; }
+
+		// tells the file apart from another one that has been saved under its name since
+		std::uint64_t fileId() const noexcept { return file_id; }
+		std::uint64_t fileSize() const noexcept { return file_size; }
+	};
+
+	// waits for a file to change; it is followed by name, so saving another file over it is a change as well. Uses
+	// inotify on Linux, elsewhere it checks the size and the time of the last change of the file every so often
+	class FileWatch
+	{
+		class Watch;
+		std::unique_ptr<Watch> watch;
+
+	public:
+		FileWatch() noexcept;
+		~FileWatch();
+
+		// has to succeed before wait is called
+		[[nodiscard]]
+		error open(const char* path) noexcept;
+
+		// returns false if the file has not changed within timeout
+		bool wait(std::chrono::milliseconds timeout) noexcept;
+	};
+
+	// reads source on a thread of its own, a few blocks ahead of the ones that are handed to readTriangles, so that
+	// waiting for the input and parsing it overlap; input that is gzip compressed is inflated on that thread as well
+	class ReadAhead : public ReadCallback
+	{
+		class Pipeline;
+		std::unique_ptr<Pipeline> pipeline;
+
+	public:
+		ReadAhead() noexcept;
+		~ReadAhead();
+
+		// has to succeed before read is called
+		[[nodiscard]]
+		error start(ReadCallback& source, std::size_t block_size) noexcept;
+
+		std::ptrdiff_t read(char* buffer, std::size_t size) noexcept override;
+	};
+
+	// a file that is read ahead, see ReadAhead
+	class ReadAheadFile : public ReadCallback
+	{
+		class Source;
+		std::unique_ptr<Source> source;
+		ReadAhead input;
+
+	public:
+		ReadAheadFile() noexcept;
+		~ReadAheadFile();
+
+		// has to succeed before read is called
+		[[nodiscard]]
+		error open(const char* path, std::size_t block_size) noexcept;
+
+		std::ptrdiff_t read(char* buffer, std::size_t size) noexcept override;
+	};
+}
+
+#endif  // INCLUDED_OBJ_FILE
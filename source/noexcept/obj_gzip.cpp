@@ -0,0 +1,188 @@
+#include <cstring>
+#include <climits>
+#include <new>
+#include <algorithm>
+
+#if defined(OBJ_ZLIB)
+#include <zlib.h>
+#endif
+
+#include "obj_gzip.h"
+
+
+namespace
+{
+	constexpr std::size_t INPUT_BUFFER_SIZE = 1 << 16;
+}
+
+namespace OBJ
+{
+	bool isGzip(const char* begin, const char* end) noexcept
+	{
+		return end - begin >= 2 && static_cast<unsigned char>(begin[0]) == 0x1F && static_cast<unsigned char>(begin[1]) == 0x8B;
+	}
+
+#if defined(OBJ_ZLIB)
+	struct GzipReadCallback::Inflater
+	{
+		z_stream stream = {};
+		bool initialized = false;
+		bool in_member = false;  // a member has been started and not finished yet
+
+		[[nodiscard]]
+		bool init() noexcept
+		{
+			// 16 selects the gzip wrapper
+			initialized = inflateInit2(&stream, 16 + MAX_WBITS) == Z_OK;
+			return initialized;
+		}
+
+		~Inflater()
+		{
+			if (initialized)
+				inflateEnd(&stream);
+		}
+	};
+#else
+	struct GzipReadCallback::Inflater
+	{
+		[[nodiscard]]
+		bool init() noexcept
+		{
+			return false;
+		}
+	};
+#endif
+
+	GzipReadCallback::GzipReadCallback(ReadCallback& source) noexcept
+		: source(source)
+	{
+	}
+
+	GzipReadCallback::~GzipReadCallback() = default;
+
+	// reads the next chunk of source, returns 0 at its end and -1 if reading failed
+	std::ptrdiff_t GzipReadCallback::fillInput() noexcept
+	{
+		if (!input)
+		{
+			input.reset(new (std::nothrow) char[INPUT_BUFFER_SIZE]);
+
+			if (!input)
+				return -1;
+		}
+
+		auto n = source.read(&input[0], INPUT_BUFFER_SIZE);
+
+		if (n < 0)
+			return -1;
+
+		pending = &input[0];
+		num_pending = static_cast<std::size_t>(n);
+		source_end = n == 0;
+		return n;
+	}
+
+	bool GzipReadCallback::detectFormat() noexcept
+	{
+		auto n = fillInput();
+
+		if (n < 0)
+			return false;
+
+		// the first read may be short of the two bytes that tell
+		if (n == 1)
+		{
+			auto m = source.read(&input[1], 1);
+
+			if (m < 0)
+				return false;
+
+			num_pending += static_cast<std::size_t>(m);
+		}
+
+		if (isGzip(pending, pending + num_pending))
+		{
+			inflater.reset(new (std::nothrow) Inflater());
+
+			if (!inflater || !inflater->init())
+				return false;
+
+			format = Format::GZIP;
+		}
+		else
+			format = Format::PLAIN;
+
+		return true;
+	}
+
+	std::ptrdiff_t GzipReadCallback::inflate(char* buffer, std::size_t size) noexcept
+	{
+#if defined(OBJ_ZLIB)
+		auto& stream = inflater->stream;
+
+		stream.next_out = reinterpret_cast<Bytef*>(buffer);
+		stream.avail_out = static_cast<uInt>(std::min<std::size_t>(size, UINT_MAX));
+		auto capacity = stream.avail_out;
+
+		while (stream.avail_out == capacity)
+		{
+			if (num_pending == 0)
+			{
+				auto n = fillInput();
+
+				if (n < 0)
+					return -1;
+
+				if (n == 0)
+				{
+					// a member that is cut off is as broken as one that is corrupt
+					return inflater->in_member ? -1 : 0;
+				}
+			}
+
+			stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pending));
+			stream.avail_in = static_cast<uInt>(num_pending);
+			inflater->in_member = true;
+
+			int ret = ::inflate(&stream, Z_NO_FLUSH);
+
+			pending = reinterpret_cast<const char*>(stream.next_in);
+			num_pending = stream.avail_in;
+
+			if (ret == Z_STREAM_END)
+			{
+				// another member may follow
+				inflateReset(&stream);
+				inflater->in_member = false;
+			}
+			else if (ret != Z_OK && ret != Z_BUF_ERROR)
+				return -1;
+		}
+
+		return static_cast<std::ptrdiff_t>(capacity - stream.avail_out);
+#else
+		return -1;
+#endif
+	}
+
+	std::ptrdiff_t GzipReadCallback::read(char* buffer, std::size_t size) noexcept
+	{
+		if (format == Format::UNKNOWN && !detectFormat())
+			return -1;
+
+		if (format == Format::GZIP)
+			return inflate(buffer, size);
+
+		if (num_pending != 0)
+		{
+			auto n = std::min(size, num_pending);
+			std::memcpy(buffer, pending, n);
+			pending += n;
+			num_pending -= n;
+			return static_cast<std::ptrdiff_t>(n);
+		}
+
+		return source_end ? 0 : source.read(buffer, size);
+	}
+}
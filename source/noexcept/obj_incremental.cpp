@@ -0,0 +1,166 @@
+#include <cstring>
+#include <new>
+#include <algorithm>
+#include <iterator>
+
+#include <parse/kernels.h>
+
+#include "obj_stream.h"
+#include "obj_reader.h"
+#include "obj_indexed_reader.h"
+#include "obj_gzip.h"
+#include "obj_incremental.h"
+
+
+namespace
+{
+	// a Stream over lines that do not start at the top of the file
+	class TailStream : public OBJ::Stream
+	{
+	public:
+		TailStream(const char* begin, const char* end, const char* name, OBJ::StreamCallback& callback, int first_line) noexcept
+			: OBJ::Stream(begin, end, name, callback)
+		{
+			line = first_line;
+		}
+	};
+
+	// the end of the last complete line in [begin, end)
+	const char* lastLineEnd(const char* begin, const char* end) noexcept
+	{
+		auto p = std::find(std::make_reverse_iterator(end), std::make_reverse_iterator(begin), '\n');
+		return p.base();
+	}
+}
+
+namespace OBJ
+{
+	IncrementalOBJ::IncrementalOBJ() noexcept = default;
+
+	IncrementalOBJ::~IncrementalOBJ() = default;
+
+	error IncrementalOBJ::open(const char* path, StreamCallback& stream_callback, const ReadOptions& options) noexcept
+	{
+		auto length = std::strlen(path);
+		this->path.reset(new (std::nothrow) char[length + 1]);
+
+		if (!this->path)
+			return error::ALLOCATION_FAILED;
+
+		std::memcpy(&this->path[0], path, length + 1);
+
+		name = std::find_if(std::make_reverse_iterator(&this->path[length]), std::make_reverse_iterator(&this->path[0]), [](auto c)
+		{
+			return c == '/' || c == '\\';
+		}).base();
+
+		this->stream_callback = &stream_callback;
+		this->options = options;
+
+		if (error err = watch.open(&this->path[0]); err != error::SUCCESS)
+			return err;
+
+		return reload();
+	}
+
+	error IncrementalOBJ::parse(const char* begin, const char* end) noexcept
+	{
+		TailStream stream(begin, end, name, *stream_callback, line);
+
+		stale = true;
+
+		if (options.engine == Engine::INDEXED)
+		{
+			IndexedReader<detail::IncrementalConsumer> reader(*consumer);
+			if (error err = stream.consume(reader); err != error::SUCCESS)
+				return err;
+		}
+		else
+		{
+			Reader<detail::IncrementalConsumer> reader(*consumer);
+			if (error err = stream.consume(reader); err != error::SUCCESS)
+				return err;
+		}
+
+		// the faces at the end would otherwise wait for the next batch to be merged
+		if (error err = consumer->mergeFaces(); err != error::SUCCESS)
+			return err;
+
+		stale = false;
+
+		line += static_cast<std::int64_t>(parse::activeKernels().countNewlines(begin, end));
+		parsed += static_cast<std::uint64_t>(end - begin);
+
+		std::size_t n = end - begin;
+
+		if (n >= PARSED_END_SIZE)
+		{
+			std::memcpy(parsed_end, end - PARSED_END_SIZE, PARSED_END_SIZE);
+			parsed_end_size = PARSED_END_SIZE;
+		}
+		else
+		{
+			std::size_t keep = std::min(parsed_end_size, PARSED_END_SIZE - n);
+			std::memmove(parsed_end, parsed_end + parsed_end_size - keep, keep);
+			std::memcpy(parsed_end + keep, begin, n);
+			parsed_end_size = keep + n;
+		}
+
+		return error::SUCCESS;
+	}
+
+	error IncrementalOBJ::reload() noexcept
+	{
+		FileTail file;
+		if (error err = file.open(&path[0], 0); err != error::SUCCESS)
+			return err;
+
+		if (isGzip(file.begin(), file.end()))
+			return error::UNSUPPORTED_FEATURE;
+
+		consumer.reset(new (std::nothrow) detail::IncrementalConsumer(options.hash_seed));
+
+		if (!consumer)
+			return error::ALLOCATION_FAILED;
+
+		file_id = file.fileId();
+		parsed = 0;
+		line = 1;
+		parsed_end_size = 0;
+
+		return parse(file.begin(), lastLineEnd(file.begin(), file.end()));
+	}
+
+	error IncrementalOBJ::update(Change& change) noexcept
+	{
+		change = Change::RELOADED;
+
+		if (stale)
+			return reload();
+
+		// the end of what has been parsed is read again along with what comes after it
+		FileTail tail;
+		if (error err = tail.open(&path[0], parsed - parsed_end_size); err != error::SUCCESS)
+			return err;
+
+		if (tail.fileId() != file_id || tail.fileSize() < parsed || std::memcmp(tail.begin(), parsed_end, parsed_end_size) != 0)
+			return reload();
+
+		auto begin = tail.begin() + parsed_end_size;
+		auto end = lastLineEnd(begin, tail.end());
+
+		if (begin == end)
+		{
+			change = Change::NONE;
+			return error::SUCCESS;
+		}
+
+		change = Change::APPENDED;
+		return parse(begin, end);
+	}
+
+	bool IncrementalOBJ::waitForChange(std::chrono::milliseconds timeout) noexcept
+	{
+		return watch.wait(timeout);
+	}
+}
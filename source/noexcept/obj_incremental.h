@@ -0,0 +1,97 @@
+#ifndef INCLUDED_OBJ_INCREMENTAL
+#define INCLUDED_OBJ_INCREMENTAL
+
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <chrono>
+
+#include "dynamic_array.h"
+#include "obj_consumer.h"
+#include "obj_file.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	namespace detail
+	{
+		// an OBJConsumer whose triangles can be looked at while it goes on taking statements
+		class IncrementalConsumer : public OBJConsumer
+		{
+		public:
+			using OBJConsumer::OBJConsumer;
+
+			const dynamic_array<float3>& positionList() const noexcept { return positions; }
+			const dynamic_array<float3>& normalList() const noexcept { return normals; }
+			const dynamic_array<float2>& texcoordList() const noexcept { return texcoords; }
+			const dynamic_array<std::array<int, 3>>& triangleList() const noexcept { return triangles; }
+		};
+	}
+
+	// the triangles of an OBJ file that is appended to or saved again while it is being looked at: update only parses
+	// the lines that were appended since the last time, on top of what the ones before left in the consumer; if the file
+	// was replaced or the end of what was parsed before has changed, it is read again from the start. Only complete lines
+	// are parsed, a last line without a newline waits until it has one. Compressed files are UNSUPPORTED_FEATURE
+	class IncrementalOBJ
+	{
+	public:
+		enum class Change
+		{
+			NONE,
+			APPENDED,
+			RELOADED
+		};
+
+	private:
+		// how much of the end of the lines that have been parsed is compared to tell whether the file still has them
+		static constexpr std::size_t PARSED_END_SIZE = 1 << 12;
+
+		std::unique_ptr<char[]> path;
+		const char* name = nullptr;
+		StreamCallback* stream_callback = nullptr;
+		ReadOptions options;
+		FileWatch watch;
+
+		std::unique_ptr<detail::IncrementalConsumer> consumer;
+		std::uint64_t file_id = 0;
+		std::uint64_t parsed = 0;  // the lines at the start of the file that are in the consumer
+		std::int64_t line = 1;     // the line that parsed ends before
+		char parsed_end[PARSED_END_SIZE];  // the last bytes of those lines, to tell whether the file still has them
+		std::size_t parsed_end_size = 0;
+		bool stale = false;        // parsing stopped at an error, partway through the lines it was given
+
+		[[nodiscard]]
+		error parse(const char* begin, const char* end) noexcept;
+
+		[[nodiscard]]
+		error reload() noexcept;
+
+	public:
+		IncrementalOBJ() noexcept;
+		~IncrementalOBJ();
+
+		IncrementalOBJ(const IncrementalOBJ&) = delete;
+		IncrementalOBJ& operator =(const IncrementalOBJ&) = delete;
+
+		// reads the file for the first time, on a single thread; has to succeed before the rest is called
+		[[nodiscard]]
+		error open(const char* path, StreamCallback& stream_callback, const ReadOptions& options = {}) noexcept;
+
+		// catches up with the file
+		[[nodiscard]]
+		error update(Change& change) noexcept;
+
+		// returns false if the file has not changed within timeout, update tells how
+		bool waitForChange(std::chrono::milliseconds timeout) noexcept;
+
+		const dynamic_array<float3>& positions() const noexcept { return consumer->positionList(); }
+		const dynamic_array<float3>& normals() const noexcept { return consumer->normalList(); }
+		const dynamic_array<float2>& texcoords() const noexcept { return consumer->texcoordList(); }
+		const dynamic_array<std::array<int, 3>>& triangles() const noexcept { return consumer->triangleList(); }
+	};
+}
+
+#endif  // INCLUDED_OBJ_INCREMENTAL
@@ -0,0 +1,287 @@
+#ifndef INCLUDED_OBJ_INDEXED_READER
+#define INCLUDED_OBJ_INDEXED_READER
+
+#pragma once
+
+#include <cstdint>
+#include <new>
+#include <memory>
+
+#include <parse/structural_index.h>
+#include <parse/kernels.h>
+#include <parse/integer.h>
+#include <parse/float.h>
+
+#include "obj_stream.h"
+#include "obj_reader.h"
+
+
+namespace OBJ
+{
+	// two-stage alternative to Reader: first indexes the tokens and newlines of a window of complete lines,
+	// then converts the numbers on v, vn, vt and f lines straight from the index; any line that does not
+	// have the exact shape of a well-formed statement is handed to a Reader, which also produces the diagnostics
+	template <typename Consumer, typename Stream = OBJ::Stream>
+	class IndexedReader
+	{
+		static constexpr std::size_t WINDOW_SIZE = 1 << 14;
+		static constexpr int MAX_FACE_VERTICES = 32;
+		static constexpr Attributes attributes = consumer_attributes<Consumer>::value;
+
+		Consumer& consumer;
+		Reader<Consumer, Stream> reader;
+
+		std::unique_ptr<std::uint32_t[]> index_buffer;
+		parse::StructuralIndex index;
+		const char* window;
+
+
+		bool indexWindow(const char* begin, const char* end) noexcept
+		{
+			if (end - begin > static_cast<std::ptrdiff_t>(WINDOW_SIZE))
+			{
+				end = begin + WINDOW_SIZE;
+
+				while (end != begin && end[-1] != '\n')
+					--end;
+
+				if (end == begin)
+					return false;
+			}
+
+			parse::activeKernels().buildStructuralIndex(index, begin, end);
+			window = begin;
+			return true;
+		}
+
+		const char* tokenBegin(std::size_t i) const noexcept
+		{
+			return window + index.token_begin[i];
+		}
+
+		const char* tokenEnd(std::size_t i) const noexcept
+		{
+			return window + index.token_end[i];
+		}
+
+		bool convertFloat(float& f, std::size_t i) const noexcept
+		{
+			auto [token_end, err] = parse::parseFloat(tokenBegin(i), tokenEnd(i), f);
+			return err == std::errc() && token_end == tokenEnd(i);
+		}
+
+		template <typename T>
+		bool convertFaceVertex(T& v, T& n, T& t, std::size_t i) const noexcept
+		{
+			auto [token_end, err] = parse::parseFaceVertex(tokenBegin(i), tokenEnd(i), v, n, t);
+			return err == std::errc() && token_end == tokenEnd(i);
+		}
+
+		// tries to convert the statement made up of tokens [i, i + num_tokens), whose newline is at line_end;
+		// ret receives the result of the consumer if the statement could be converted
+		bool convertLine(OBJ::error& ret, Stream& stream, std::size_t i, std::size_t num_tokens, const char* line_end) noexcept
+		{
+			const char* command = tokenBegin(i);
+			auto command_length = tokenEnd(i) - command;
+
+			if (command[0] == '#')
+			{
+				stream.advance(line_end + 1);
+				ret = OBJ::error::SUCCESS;
+				return true;
+			}
+
+			if (command[0] == 'v' && command_length == 1)
+			{
+				float x, y, z, w;
+
+				if (num_tokens < 4 || num_tokens > 5 || !convertFloat(x, i + 1) || !convertFloat(y, i + 2) || !convertFloat(z, i + 3))
+					return false;
+
+				if (num_tokens == 5)
+				{
+					if (!convertFloat(w, i + 4))
+						return false;
+
+					stream.advance(line_end + 1);
+					ret = reader.emitVertex(stream, x, y, z, w);
+					return true;
+				}
+
+				stream.advance(line_end + 1);
+				ret = reader.emitVertex(stream, x, y, z);
+				return true;
+			}
+
+			if (command[0] == 'v' && command_length == 2 && command[1] == 'n')
+			{
+				if constexpr (!reads(attributes, Attributes::NORMALS))
+				{
+					if (num_tokens < 2)
+						return false;
+
+					stream.advance(line_end + 1);
+					ret = OBJ::error::SUCCESS;
+					return true;
+				}
+
+				float x, y, z;
+
+				if (num_tokens != 4 || !convertFloat(x, i + 1) || !convertFloat(y, i + 2) || !convertFloat(z, i + 3))
+					return false;
+
+				stream.advance(line_end + 1);
+				ret = reader.emitNormal(stream, x, y, z);
+				return true;
+			}
+
+			if (command[0] == 'v' && command_length == 2 && command[1] == 't')
+			{
+				if constexpr (!reads(attributes, Attributes::TEXCOORDS))
+				{
+					if (num_tokens < 2)
+						return false;
+
+					stream.advance(line_end + 1);
+					ret = OBJ::error::SUCCESS;
+					return true;
+				}
+
+				float uvw[3];
+
+				if (num_tokens < 2 || num_tokens > 4)
+					return false;
+
+				for (std::size_t j = 1; j < num_tokens; ++j)
+					if (!convertFloat(uvw[j - 1], i + j))
+						return false;
+
+				stream.advance(line_end + 1);
+
+				if (num_tokens == 2)
+					ret = reader.emitTexcoord(stream, uvw[0]);
+				else if (num_tokens == 3)
+					ret = reader.emitTexcoord(stream, uvw[0], uvw[1]);
+				else
+					ret = reader.emitTexcoord(stream, uvw[0], uvw[1], uvw[2]);
+				return true;
+			}
+
+			if (command[0] == 'f' && command_length == 1)
+			{
+				consumer_index_t<Consumer> vnt[MAX_FACE_VERTICES][3];
+				auto num_vertices = num_tokens - 1;
+
+				if (num_vertices < 1 || num_vertices > MAX_FACE_VERTICES)
+					return false;
+
+				for (std::size_t j = 0; j < num_vertices; ++j)
+					if (!convertFaceVertex(vnt[j][0], vnt[j][1], vnt[j][2], i + 1 + j))
+						return false;
+
+				if (ret = reader.flush(stream); ret != OBJ::error::SUCCESS)
+					return true;
+
+				for (std::size_t j = 0; j < num_vertices; ++j)
+				{
+					if (ret = reader.emitFaceVertex(stream, vnt[j][0], vnt[j][1], vnt[j][2]); ret != OBJ::error::SUCCESS)
+						return true;
+				}
+
+				if (ret = reader.flushFaceVertices(stream); ret != OBJ::error::SUCCESS)
+					return true;
+
+				stream.advance(line_end + 1);
+				ret = consumer.finishFace(stream);
+				return true;
+			}
+
+			return false;
+		}
+
+		[[nodiscard]]
+		OBJ::error consumeWindow(Stream& stream) noexcept
+		{
+			std::size_t t = 0;
+			std::size_t l = 0;
+
+			// the stream is already past the first command character, which starts the window
+			for (const char* pos = window; ; pos = stream.position())
+			{
+				while (t < index.num_tokens && tokenBegin(t) < pos)
+					++t;
+
+				if (t == index.num_tokens)
+					return OBJ::error::SUCCESS;
+
+				while (l < index.num_newlines && window + index.newlines[l] < pos)
+					++l;
+
+				const char* command = tokenBegin(t);
+
+				while (l < index.num_newlines && window + index.newlines[l] < command)
+					++l;
+
+				stream.advance(command + 1);
+
+				// the last line of the file may lack a newline, leave that one to the Reader
+				if (l < index.num_newlines)
+				{
+					const char* line_end = window + index.newlines[l];
+
+					std::size_t num_tokens = 1;
+					while (t + num_tokens < index.num_tokens && tokenBegin(t + num_tokens) < line_end)
+						++num_tokens;
+
+					if (OBJ::error ret; convertLine(ret, stream, t, num_tokens, line_end))
+					{
+						if (ret != OBJ::error::SUCCESS)
+							return ret;
+
+						t += num_tokens;
+						++l;
+						continue;
+					}
+				}
+
+				if (auto ret = reader.consume(stream, *command); ret != OBJ::error::SUCCESS)
+					return ret;
+			}
+		}
+
+	public:
+		IndexedReader(Consumer& consumer) noexcept
+			: consumer(consumer), reader(consumer)
+		{
+		}
+
+		[[nodiscard]]
+		OBJ::error finish(Stream& stream) noexcept
+		{
+			return reader.finish(stream);
+		}
+
+		[[nodiscard]]
+		OBJ::error consume(Stream& stream, char c) noexcept
+		{
+			if (!index_buffer)
+			{
+				index_buffer.reset(new (std::nothrow) std::uint32_t[2 * parse::maxTokens(WINDOW_SIZE) + parse::maxNewlines(WINDOW_SIZE)]);
+
+				if (!index_buffer)
+					return OBJ::error::ALLOCATION_FAILED;
+
+				index.token_begin = &index_buffer[0];
+				index.token_end = index.token_begin + parse::maxTokens(WINDOW_SIZE);
+				index.newlines = index.token_end + parse::maxTokens(WINDOW_SIZE);
+			}
+
+			if (!indexWindow(stream.position() - 1, stream.limit()))
+				return reader.consume(stream, c);
+
+			return consumeWindow(stream);
+		}
+	};
+}
+
+#endif  // INCLUDED_OBJ_INDEXED_READER
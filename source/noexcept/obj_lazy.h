@@ -0,0 +1,400 @@
+#ifndef INCLUDED_OBJ_LAZY
+#define INCLUDED_OBJ_LAZY
+
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <string_view>
+
+#include <parse/scan.h>
+#include <parse/kernels.h>
+
+#include "dynamic_array.h"
+#include "hash_map.h"
+
+#include "obj_stream.h"
+#include "obj_reader.h"
+#include "obj_consumer.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	namespace detail
+	{
+		// parses the statements that LazyOBJ hands to it one at a time, keeping what the last one produced
+		class LazyStatementConsumer : public OBJConsumer
+		{
+			using OBJConsumer::checkFaceVertexCount;
+			using OBJConsumer::checkFaceSize;
+
+		public:
+			using OBJConsumer::MAX_FACE_VERTICES;
+
+			face_vertex_t face[MAX_FACE_VERTICES];
+			std::string_view object_name;
+
+			// forgets about a statement that failed halfway
+			void reset() noexcept
+			{
+				num_face_vertices = 0;
+			}
+
+			int faceSize() const noexcept
+			{
+				return num_face_vertices;
+			}
+
+			template <typename Stream>
+			[[nodiscard]]
+			OBJ::error consumeFaceVertex(Stream& stream, int vi, int ni, int ti) noexcept
+			{
+				if (!checkFaceVertexCount(stream, num_face_vertices))
+					return OBJ::error::SYNTAX_ERROR;
+
+				face[num_face_vertices++] = { vi, ni, ti };
+				return OBJ::error::SUCCESS;
+			}
+
+			template <typename Stream>
+			[[nodiscard]]
+			OBJ::error consumeFaceVertices(Stream& stream, const face_vertex_t* vertices, int count) noexcept
+			{
+				for (int i = 0; i < count; ++i)
+					if (auto ret = consumeFaceVertex(stream, vertices[i].v, vertices[i].n, vertices[i].t); ret != OBJ::error::SUCCESS)
+						return ret;
+
+				return OBJ::error::SUCCESS;
+			}
+
+			// keeps the face around until the next statement, unlike the other consumers
+			template <typename Stream>
+			[[nodiscard]]
+			OBJ::error finishFace(Stream& stream) noexcept
+			{
+				if (!checkFaceSize(stream, num_face_vertices))
+					return OBJ::error::SYNTAX_ERROR;
+				return OBJ::error::SUCCESS;
+			}
+
+			template <typename Stream>
+			OBJ::error consumeObjectName(Stream& stream, std::string_view name) noexcept
+			{
+				object_name = name;
+				return OBJ::error::SUCCESS;
+			}
+
+			float3 takeVertex() noexcept
+			{
+				auto p = v[size(v) - 1];
+				v.pop_back();
+				return p;
+			}
+
+			float3 takeNormal() noexcept
+			{
+				auto n = vn[size(vn) - 1];
+				vn.pop_back();
+				return n;
+			}
+
+			float2 takeTexcoord() noexcept
+			{
+				auto t = vt[size(vt) - 1];
+				vt.pop_back();
+				return t;
+			}
+		};
+	}
+
+	// reads an OBJ file on demand: index only finds the lines of the v, vn, vt and f statements, vertex attributes
+	// are converted the first time they are asked for and faces whenever their triangles are; the few other statements
+	// are read by index right away. The text has to outlive the LazyOBJ, diagnostics are the same as readTriangles'
+	class LazyOBJ
+	{
+	public:
+		struct Object
+		{
+			const char* name;
+			std::size_t name_length;
+			std::size_t first_face;
+			std::size_t num_faces;
+		};
+
+	private:
+		template <typename T>
+		struct lazy_attribute
+		{
+			dynamic_array<const char*> lines;
+			dynamic_array<T> values;
+			dynamic_array<bool> converted;
+
+			[[nodiscard]]
+			bool finishIndex() noexcept
+			{
+				return values.resize(size(lines)) && converted.resize(size(lines), false);
+			}
+
+			// the number of these attributes that come before the statement at line
+			int countBefore(const char* line) const noexcept
+			{
+				return static_cast<int>(std::lower_bound(lines.begin(), lines.end(), line) - lines.begin());
+			}
+		};
+
+		const char* text_begin;
+		const char* text_end;
+		const char* name;
+		StreamCallback& stream_callback;
+
+		detail::LazyStatementConsumer consumer;
+		Reader<detail::LazyStatementConsumer> reader;
+
+		lazy_attribute<float3> vertices;
+		lazy_attribute<float3> normals;
+		lazy_attribute<float2> texcoords;
+		dynamic_array<const char*> faces;
+		dynamic_array<Object> object_list;
+
+		// a stream over the whole text, so that diagnostics have the right line numbers
+		Stream makeStream() noexcept
+		{
+			return { text_begin, text_end, name, stream_callback };
+		}
+
+		[[nodiscard]]
+		OBJ::error parseStatement(Stream& stream, const char* line) noexcept
+		{
+			consumer.reset();
+			stream.advance(line + 1);
+
+			if (auto ret = reader.consume(stream, *line); ret != OBJ::error::SUCCESS)
+				return ret;
+
+			return reader.finish(stream);
+		}
+
+		template <typename T, typename Take>
+		[[nodiscard]]
+		OBJ::error get(const T*& out, lazy_attribute<T>& attribute, std::size_t i, Take&& take) noexcept
+		{
+			if (!attribute.converted[i])
+			{
+				auto stream = makeStream();
+
+				if (auto ret = parseStatement(stream, attribute.lines[i]); ret != OBJ::error::SUCCESS)
+					return ret;
+
+				attribute.values[i] = take();
+				attribute.converted[i] = true;
+			}
+
+			out = &attribute.values[i];
+			return OBJ::error::SUCCESS;
+		}
+
+		void finishObject() noexcept
+		{
+			if (size(object_list) != 0)
+			{
+				auto& object = object_list[size(object_list) - 1];
+				object.num_faces = size(faces) - object.first_face;
+			}
+		}
+
+	public:
+		LazyOBJ(const char* begin, const char* end, const char* name, StreamCallback& stream_callback) noexcept
+			: text_begin(begin), text_end(end), name(name), stream_callback(stream_callback), reader(consumer)
+		{
+		}
+
+		// finds the statements in the text, has to succeed before any of the other functions are called
+		[[nodiscard]]
+		OBJ::error index() noexcept
+		{
+			auto stream = makeStream();
+
+			for (const char* p = parse::scan::findFirstNotOf<' ', '\t', '\r', '\n'>(text_begin, text_end); p != text_end; p = parse::scan::findFirstNotOf<' ', '\t', '\r', '\n'>(p, text_end))
+			{
+				const char* command_end = parse::scan::findFirstOf<' ', '\t', '\r', '\n', '\v', '\f'>(p, text_end);
+				std::string_view command(p, command_end - p);
+
+				bool recorded = true;
+
+				if (command == "v")
+					recorded = vertices.lines.push_back(p);
+				else if (command == "vn")
+					recorded = normals.lines.push_back(p);
+				else if (command == "vt")
+					recorded = texcoords.lines.push_back(p);
+				else if (command == "f")
+					recorded = faces.push_back(p);
+				else if (command.empty() || command[0] != '#')
+				{
+					if (auto ret = parseStatement(stream, p); ret != OBJ::error::SUCCESS)
+						return ret;
+
+					p = stream.position();
+
+					if (!consumer.object_name.empty())
+					{
+						finishObject();
+
+						if (!object_list.push_back({ consumer.object_name.data(), consumer.object_name.size(), size(faces), 0 }))
+							return OBJ::error::ALLOCATION_FAILED;
+
+						consumer.object_name = {};
+					}
+
+					continue;
+				}
+
+				if (!recorded)
+					return OBJ::error::ALLOCATION_FAILED;
+
+				p = parse::activeKernels().findNewline(command_end, text_end);
+			}
+
+			finishObject();
+
+			if (!vertices.finishIndex() || !normals.finishIndex() || !texcoords.finishIndex())
+				return OBJ::error::ALLOCATION_FAILED;
+
+			return OBJ::error::SUCCESS;
+		}
+
+		std::size_t numVertices() const noexcept
+		{
+			return size(vertices.lines);
+		}
+
+		std::size_t numNormals() const noexcept
+		{
+			return size(normals.lines);
+		}
+
+		std::size_t numTexcoords() const noexcept
+		{
+			return size(texcoords.lines);
+		}
+
+		std::size_t numFaces() const noexcept
+		{
+			return size(faces);
+		}
+
+		// the o statements of the file, with the faces that follow each of them
+		const dynamic_array<Object>& objects() const noexcept
+		{
+			return object_list;
+		}
+
+		// the attributes of the i-th v, vn and vt statements, converted the first time they are asked for
+		[[nodiscard]]
+		OBJ::error vertex(const float3*& out, std::size_t i) noexcept
+		{
+			return get(out, vertices, i, [&]() noexcept { return consumer.takeVertex(); });
+		}
+
+		[[nodiscard]]
+		OBJ::error normal(const float3*& out, std::size_t i) noexcept
+		{
+			return get(out, normals, i, [&]() noexcept { return consumer.takeNormal(); });
+		}
+
+		[[nodiscard]]
+		OBJ::error texcoord(const float2*& out, std::size_t i) noexcept
+		{
+			return get(out, texcoords, i, [&]() noexcept { return consumer.takeTexcoord(); });
+		}
+
+		// the triangles of every face_stride-th face of [first_face, first_face + num_faces), with the face vertices shared among them merged
+		[[nodiscard]]
+		OBJ::error triangles(Triangles& out, std::size_t first_face, std::size_t num_faces, std::size_t face_stride = 1) noexcept
+		{
+			Triangles triangles;
+			hash_map<vertex_key<Attributes::ALL>, int, vertex_key_hash> vertex_map;
+
+			for (std::size_t f = first_face; f < first_face + num_faces; f += face_stride)
+			{
+				const char* line = faces[f];
+				auto stream = makeStream();
+
+				if (auto ret = parseStatement(stream, line); ret != OBJ::error::SUCCESS)
+					return ret;
+
+				stream.advance(line);
+
+				// relative indices count back from the attributes that come before the face in the file
+				int num_v = vertices.countBefore(line);
+				int num_vn = normals.countBefore(line);
+				int num_vt = texcoords.countBefore(line);
+
+				// looking up the attributes parses their statements, which starts over with the consumer's face
+				face_vertex_t corners[detail::LazyStatementConsumer::MAX_FACE_VERTICES];
+				int face_vertices[detail::LazyStatementConsumer::MAX_FACE_VERTICES];
+				int num_face_vertices = consumer.faceSize();
+				std::copy(consumer.face, consumer.face + num_face_vertices, corners);
+
+				for (int i = 0; i < num_face_vertices; ++i)
+				{
+					auto [vi, ni, ti] = corners[i];
+
+					vi = vi < 0 ? num_v + vi : vi - 1;
+					ni = ni < 0 ? num_vn + ni : ni - 1;
+					ti = ti < 0 ? num_vt + ti : ti - 1;
+
+					if (vi < 0 || vi >= num_v || ni < -1 || ni >= num_vn || ti < -1 || ti >= num_vt)
+					{
+						stream.error("face vertex index out of range");
+						return OBJ::error::SYNTAX_ERROR;
+					}
+
+					auto vertex = vertex_map.try_emplace(vertex_key<Attributes::ALL>::make(vi, ni, ti), static_cast<int>(size(triangles.positions)));
+
+					if (!vertex)
+						return OBJ::error::ALLOCATION_FAILED;
+
+					auto [fv, inserted] = *vertex;
+
+					if (inserted)
+					{
+						const float3* p;
+						const float3* n = nullptr;
+						const float2* t = nullptr;
+
+						if (auto ret = this->vertex(p, vi); ret != OBJ::error::SUCCESS)
+							return ret;
+						if (auto ret = ni < 0 ? OBJ::error::SUCCESS : normal(n, ni); ret != OBJ::error::SUCCESS)
+							return ret;
+						if (auto ret = ti < 0 ? OBJ::error::SUCCESS : texcoord(t, ti); ret != OBJ::error::SUCCESS)
+							return ret;
+
+						if (!triangles.positions.push_back(*p) ||
+						    !triangles.normals.push_back(n ? *n : float3 { 0.0f, 0.0f, 0.0f }) ||
+						    !triangles.texcoords.push_back(t ? *t : float2 { 0.0f, 0.0f }))
+							return OBJ::error::ALLOCATION_FAILED;
+					}
+
+					face_vertices[i] = fv->second;
+				}
+
+				for (int i = 2; i < num_face_vertices; ++i)
+					if (!triangles.triangles.push_back({ face_vertices[0], face_vertices[i - 1], face_vertices[i] }))
+						return OBJ::error::ALLOCATION_FAILED;
+			}
+
+			out = std::move(triangles);
+			return OBJ::error::SUCCESS;
+		}
+
+		[[nodiscard]]
+		OBJ::error triangles(Triangles& out, const Object& object) noexcept
+		{
+			return triangles(out, object.first_face, object.num_faces);
+		}
+	};
+}
+
+#endif  // INCLUDED_OBJ_LAZY
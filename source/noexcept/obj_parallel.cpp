@@ -0,0 +1,300 @@
+#include <utility>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <new>
+#include <memory>
+#include <thread>
+
+#include "dynamic_array.h"
+
+#include "obj_stream.h"
+#include "obj_reader.h"
+#include "obj_indexed_reader.h"
+#include "obj_consumer.h"
+#include "obj_parallel.h"
+
+
+namespace
+{
+	constexpr std::ptrdiff_t MIN_CHUNK_SIZE = 1 << 20;
+
+	struct Diagnostic
+	{
+		bool is_error;
+		std::int64_t line;
+		const char* msg;
+	};
+
+	// buffers the diagnostics of one chunk so they can be replayed in file order once all chunks are done
+	struct DiagnosticRecorder
+	{
+		dynamic_array<Diagnostic> diagnostics;
+		bool failed = false;
+
+		void progress(float progress) noexcept
+		{
+		}
+
+		void warning(const char* file, std::int64_t line, const char* msg) noexcept
+		{
+			if (!diagnostics.push_back({ false, line, msg }))
+				failed = true;
+		}
+
+		void error(const char* file, std::int64_t line, const char* msg) noexcept
+		{
+			if (!diagnostics.push_back({ true, line, msg }))
+				failed = true;
+		}
+
+		void finish() noexcept
+		{
+		}
+	};
+
+	using ChunkStream = OBJ::BasicStream<DiagnosticRecorder>;
+
+
+	// collects vertex attributes like an OBJConsumer but only records the face vertices of its chunk,
+	// since deduplication has to see the faces of all chunks in file order
+	template <OBJ::Attributes A, typename Index>
+	class ChunkConsumer : public OBJ::BasicOBJConsumer<A, Index>
+	{
+		using base = OBJ::BasicOBJConsumer<A, Index>;
+		using base::v;
+		using base::vn;
+		using base::vt;
+		using base::num_face_vertices;
+		using base::checkFaceVertexCount;
+		using base::checkFaceSize;
+
+		dynamic_array<OBJ::basic_face_vertex<Index>> corners;
+		dynamic_array<std::uint8_t> face_sizes;
+
+		// relative indices refer to attributes from before the face and possibly from previous chunks;
+		// they are recorded relative to the start of the chunk until the chunk's attribute counts are known
+		dynamic_array<std::size_t> relative_indices[3];
+
+		[[nodiscard]]
+		bool resolveLocal(Index& i, Index num_attributes, int component) noexcept
+		{
+			if (i >= 0)
+				return true;
+			i = num_attributes + i;
+			return relative_indices[component].push_back(size(corners));
+		}
+
+	public:
+		[[nodiscard]]
+		OBJ::error consumeFaceVertex(ChunkStream& stream, Index vi, Index ni, Index ti) noexcept
+		{
+			if (!checkFaceVertexCount(stream, num_face_vertices))
+				return OBJ::error::SYNTAX_ERROR;
+
+			if (!resolveLocal(vi, static_cast<Index>(size(v)), 0) ||
+			    !resolveLocal(ni, static_cast<Index>(size(vn)), 1) ||
+			    !resolveLocal(ti, static_cast<Index>(size(vt)), 2) ||
+			    !corners.push_back({ vi, ni, ti }))
+				return OBJ::error::ALLOCATION_FAILED;
+
+			++num_face_vertices;
+			return OBJ::error::SUCCESS;
+		}
+
+		[[nodiscard]]
+		OBJ::error consumeFaceVertices(ChunkStream& stream, const OBJ::basic_face_vertex<Index>* vertices, int count) noexcept
+		{
+			for (int i = 0; i < count; ++i)
+				if (auto ret = consumeFaceVertex(stream, vertices[i].v, vertices[i].n, vertices[i].t); ret != OBJ::error::SUCCESS)
+					return ret;
+
+			return OBJ::error::SUCCESS;
+		}
+
+		[[nodiscard]]
+		OBJ::error finishFace(ChunkStream& stream) noexcept
+		{
+			if (!checkFaceSize(stream, num_face_vertices))
+				return OBJ::error::SYNTAX_ERROR;
+
+			if (!face_sizes.push_back(static_cast<std::uint8_t>(num_face_vertices)))
+				return OBJ::error::ALLOCATION_FAILED;
+
+			num_face_vertices = 0;
+			return OBJ::error::SUCCESS;
+		}
+
+		void finishChunk() noexcept
+		{
+			// turn chunk-relative indices back into indices relative to the end of the chunk,
+			// which is where the attribute counts will be when the faces are replayed
+			for (auto i : relative_indices[0])
+				corners[i].v -= static_cast<Index>(size(v));
+			for (auto i : relative_indices[1])
+				corners[i].n -= static_cast<Index>(size(vn));
+			for (auto i : relative_indices[2])
+				corners[i].t -= static_cast<Index>(size(vt));
+		}
+
+		std::size_t numVertices() const noexcept
+		{
+			return size(v);
+		}
+
+		[[nodiscard]]
+		OBJ::error replay(OBJ::BasicOBJConsumer<A, Index>& consumer, OBJ::Stream& stream) noexcept
+		{
+			if (auto ret = consumer.appendAttributes(std::move(*this)); ret != OBJ::error::SUCCESS)
+				return ret;
+
+			auto corner = corners.begin();
+			for (int num_vertices : face_sizes)
+			{
+				if (auto ret = consumer.consumeFaceVertices(stream, corner, num_vertices); ret != OBJ::error::SUCCESS)
+					return ret;
+
+				if (auto ret = consumer.finishFace(stream); ret != OBJ::error::SUCCESS)
+					return ret;
+
+				corner += num_vertices;
+			}
+
+			return OBJ::error::SUCCESS;
+		}
+	};
+
+
+	template <OBJ::Attributes A, typename Index>
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+		DiagnosticRecorder diagnostics;
+		ChunkConsumer<A, Index> consumer;
+		std::int64_t num_lines = 0;
+		OBJ::error result = OBJ::error::SUCCESS;
+	};
+
+	template <typename Reader, OBJ::Attributes A, typename Index>
+	void parseChunk(Chunk<A, Index>& chunk, const char* name) noexcept
+	{
+		ChunkStream stream(chunk.begin, chunk.end, name, chunk.diagnostics);
+		Reader reader(chunk.consumer);
+
+		if (chunk.result = stream.consume(reader); chunk.result != OBJ::error::SUCCESS)
+			return;
+
+		chunk.consumer.finishChunk();
+		chunk.num_lines = stream.lineNumber() - 1;
+	}
+
+	template <OBJ::Attributes A, typename Index>
+	void splitChunks(Chunk<A, Index>* chunks, const char* begin, const char* end, int num_chunks) noexcept
+	{
+		auto size = end - begin;
+		const char* chunk_begin = begin;
+
+		for (int i = 0; i < num_chunks; ++i)
+		{
+			const char* chunk_end = std::max(begin + size * (i + 1) / num_chunks, chunk_begin);
+
+			if (chunk_end != end)
+			{
+				auto newline = static_cast<const char*>(std::memchr(chunk_end, '\n', end - chunk_end));
+				chunk_end = newline ? newline + 1 : end;
+			}
+
+			chunks[i].begin = chunk_begin;
+			chunks[i].end = chunk_end;
+			chunk_begin = chunk_end;
+		}
+	}
+}
+
+namespace OBJ
+{
+	int parallelChunkCount(std::ptrdiff_t size, int num_threads) noexcept
+	{
+		if (num_threads <= 0)
+			num_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+		return static_cast<int>(std::min<std::ptrdiff_t>(num_threads, size / MIN_CHUNK_SIZE + 1));
+	}
+
+	template <Attributes A, typename Index>
+	error readTrianglesParallel(BasicTriangles<A, Index>& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options) noexcept
+	{
+		auto parseChunk = options.engine == Engine::INDEXED ? ::parseChunk<IndexedReader<ChunkConsumer<A, Index>, ChunkStream>, A, Index> : ::parseChunk<Reader<ChunkConsumer<A, Index>, ChunkStream>, A, Index>;
+
+		auto chunks = std::unique_ptr<Chunk<A, Index>[]> { new (std::nothrow) Chunk<A, Index>[num_chunks] };
+		auto workers = std::unique_ptr<std::thread[]> { new (std::nothrow) std::thread[num_chunks - 1] };
+
+		if (!chunks || !workers)
+			return error::ALLOCATION_FAILED;
+
+		splitChunks(&chunks[0], begin, end, num_chunks);
+
+		for (int i = 1; i < num_chunks; ++i)
+			workers[i - 1] = std::thread(parseChunk, std::ref(chunks[i]), name);
+
+		parseChunk(chunks[0], name);
+
+		for (int i = 1; i < num_chunks; ++i)
+			workers[i - 1].join();
+
+		BasicOBJConsumer<A, Index> consumer(options.hash_seed);
+		Stream stream(end, end, name, stream_callback);
+
+		// faces mostly share their positions, which makes there about as many output vertices as positions
+		std::size_t num_vertices = 0;
+		for (int i = 0; i < num_chunks; ++i)
+			num_vertices += chunks[i].consumer.numVertices();
+
+		if (auto ret = consumer.reserveVertices(num_vertices); ret != error::SUCCESS)
+			return ret;
+
+		std::int64_t line_offset = 0;
+		for (int i = 0; i < num_chunks; ++i)
+		{
+			auto& chunk = chunks[i];
+
+			if (chunk.diagnostics.failed)
+				return error::ALLOCATION_FAILED;
+
+			for (const auto& d : chunk.diagnostics.diagnostics)
+			{
+				if (d.is_error)
+					stream_callback.error(name, line_offset + d.line, d.msg);
+				else
+					stream_callback.warning(name, line_offset + d.line, d.msg);
+			}
+
+			if (chunk.result != error::SUCCESS)
+				return chunk.result;
+
+			if (auto ret = chunk.consumer.replay(consumer, stream); ret != error::SUCCESS)
+				return ret;
+
+			line_offset += chunk.num_lines;
+
+			stream_callback.progress(static_cast<float>(i + 1) / num_chunks);
+		}
+
+		if (auto ret = consumer.mergeFaces(); ret != error::SUCCESS)
+			return ret;
+
+		stream_callback.finish();
+		out = consumer.finish();
+		return error::SUCCESS;
+	}
+
+	template error readTrianglesParallel<Attributes::POSITIONS, int>(BasicTriangles<Attributes::POSITIONS, int>& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options) noexcept;
+	template error readTrianglesParallel<Attributes::NORMALS, int>(BasicTriangles<Attributes::NORMALS, int>& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options) noexcept;
+	template error readTrianglesParallel<Attributes::TEXCOORDS, int>(BasicTriangles<Attributes::TEXCOORDS, int>& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options) noexcept;
+	template error readTrianglesParallel<Attributes::ALL, int>(BasicTriangles<Attributes::ALL, int>& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options) noexcept;
+	template error readTrianglesParallel<Attributes::POSITIONS, std::int64_t>(BasicTriangles<Attributes::POSITIONS, std::int64_t>& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options) noexcept;
+	template error readTrianglesParallel<Attributes::NORMALS, std::int64_t>(BasicTriangles<Attributes::NORMALS, std::int64_t>& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options) noexcept;
+	template error readTrianglesParallel<Attributes::TEXCOORDS, std::int64_t>(BasicTriangles<Attributes::TEXCOORDS, std::int64_t>& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options) noexcept;
+	template error readTrianglesParallel<Attributes::ALL, std::int64_t>(BasicTriangles<Attributes::ALL, std::int64_t>& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options) noexcept;
+}
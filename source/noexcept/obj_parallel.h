@@ -0,0 +1,21 @@
+#ifndef INCLUDED_OBJ_PARALLEL
+#define INCLUDED_OBJ_PARALLEL
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "obj.h"
+
+
+namespace OBJ
+{
+	int parallelChunkCount(std::ptrdiff_t size, int num_threads) noexcept;
+
+	// instantiated for every combination of Attributes, with int and std::int64_t indices, in obj_parallel.cpp
+	template <Attributes A, typename Index>
+	error readTrianglesParallel(BasicTriangles<A, Index>& out, const char* begin, const char* end, const char* name, StreamCallback& stream_callback, int num_chunks, const ReadOptions& options) noexcept;
+}
+
+#endif  // INCLUDED_OBJ_PARALLEL
@@ -3,18 +3,61 @@
 
 #pragma once
 
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+
+#include <parse/keyword_table.h>
+
 #include "obj_stream.h"
+#include "obj_batch.h"
 
 
 namespace OBJ
 {
+	// the vertex attributes a consumer reads, all of them unless it declares a static constexpr Attributes attributes member
+	template <typename Consumer, typename = void>
+	struct consumer_attributes : std::integral_constant<Attributes, Attributes::ALL>
+	{
+	};
+
 	template <typename Consumer>
+	struct consumer_attributes<Consumer, std::void_t<decltype(Consumer::attributes)>> : std::integral_constant<Attributes, Consumer::attributes>
+	{
+	};
+
+	template <typename Consumer, typename Stream = OBJ::Stream>
 	class Reader
 	{
+		static constexpr Attributes attributes = consumer_attributes<Consumer>::value;
+		static constexpr bool batched = accepts_batches<Consumer, Stream>::value;
+
+		using index_type = consumer_index_t<Consumer>;
+
+		struct unbatched
+		{
+		};
+
+		template <typename T>
+		using batch_t = std::conditional_t<batched, batch<T>, unbatched>;
+
 		Consumer& consumer;
+		std::optional<parse::FaceFormat> face_format;
+
+		batch_t<float3> vertices;
+		batch_t<float3> normals;
+		batch_t<float2> texcoords;
+		batch_t<basic_face_vertex<index_type>> face_vertices;
+
+		struct command
+		{
+			OBJ::error (Reader::*consume)(Stream& stream) noexcept;
+			bool attribute = false;  // batched attributes are flushed before any other statement
+			bool ignore_without_arguments = false;
+		};
 
 		[[nodiscard]]
-		OBJ::error consumeVertex(OBJ::Stream& stream) noexcept
+		OBJ::error consumeVertex(Stream& stream) noexcept
 		{
 			if (auto x = stream.expectFloat(); x && stream.expectHorizontalWS())
 			{
@@ -26,12 +69,12 @@ namespace OBJ
 						{
 							if (!stream.expectLineEnd())
 								return OBJ::error::SYNTAX_ERROR;
-							return consumer.consumeVertex(stream, *x, *y, *z, w);
+							return emitVertex(stream, *x, *y, *z, w);
 						}
 
 						if (!stream.expectLineEnd())
 							return OBJ::error::SYNTAX_ERROR;
-						return consumer.consumeVertex(stream, *x, *y, *z);
+						return emitVertex(stream, *x, *y, *z);
 					}
 				}
 			}
@@ -40,7 +83,7 @@ namespace OBJ
 		}
 
 		[[nodiscard]]
-		OBJ::error consumeNormal(OBJ::Stream& stream) noexcept
+		OBJ::error consumeNormal(Stream& stream) noexcept
 		{
 			if (auto x = stream.expectFloat(); x && stream.expectHorizontalWS())
 			{
@@ -48,7 +91,7 @@ namespace OBJ
 				{
 					if (auto z = stream.expectFloat(); z && stream.expectLineEnd())
 					{
-						return consumer.consumeNormal(stream, *x, *y, *z);
+						return emitNormal(stream, *x, *y, *z);
 					}
 				}
 			}
@@ -57,7 +100,7 @@ namespace OBJ
 		}
 
 		[[nodiscard]]
-		OBJ::error consumeTexcoord(OBJ::Stream& stream) noexcept
+		OBJ::error consumeTexcoord(Stream& stream) noexcept
 		{
 			if (auto u = stream.expectFloat())
 			{
@@ -67,52 +110,87 @@ namespace OBJ
 					{
 						if (!stream.expectLineEnd())
 							return OBJ::error::SYNTAX_ERROR;
-						return consumer.consumeTexcoord(stream, *u, v, w);
+						return emitTexcoord(stream, *u, v, w);
 					}
 
 					if (!stream.expectLineEnd())
 						return OBJ::error::SYNTAX_ERROR;
-					return consumer.consumeTexcoord(stream, *u, v);
+					return emitTexcoord(stream, *u, v);
 				}
 
 				if (!stream.expectLineEnd())
 					return OBJ::error::SYNTAX_ERROR;
-				return consumer.consumeTexcoord(stream, *u);
+				return emitTexcoord(stream, *u);
 			}
 
 			return OBJ::error::SYNTAX_ERROR;
 		}
 
+		// parses a face expecting all its vertices to have format F, any vertex that does not goes through
+		// the generic expectFaceVertex; matched is set to false if that was necessary
+		template <parse::FaceFormat F>
 		[[nodiscard]]
-		OBJ::error consumeFace(OBJ::Stream& stream) noexcept
+		OBJ::error consumeFaceAs(Stream& stream, bool& matched) noexcept
 		{
+			matched = true;
+
 			do
 			{
-				auto v = stream.expectInteger();
-
-				if (!v)
-					return OBJ::error::SYNTAX_ERROR;
-
-				int t = 0;
-				int n = 0;
+				index_type v, n, t;
 
-				if (stream.consume<'/'>())
+				if (!stream.template consumeFaceVertex<F>(v, n, t))
 				{
-					stream.consumeInteger(t);
-
-					if (stream.consume<'/'>())
-						stream.consumeInteger(n);
+					if (!stream.expectFaceVertex(v, n, t))
+						return OBJ::error::SYNTAX_ERROR;
+					matched = false;
 				}
 
-				if (auto ret = consumer.consumeFaceVertex(stream, *v, n, t); ret != OBJ::error::SUCCESS)
+				if (auto ret = emitFaceVertex(stream, v, n, t); ret != OBJ::error::SUCCESS)
 					return ret;
-			} while (!stream.finishLine());
+			} while (!stream.atLineEnd());
+
+			if (auto ret = flushFaceVertices(stream); ret != OBJ::error::SUCCESS)
+				return ret;
 
+			stream.finishLine();
 			return consumer.finishFace(stream);
 		}
 
 		[[nodiscard]]
-		OBJ::error consumeObjectName(OBJ::Stream& stream) noexcept
+		OBJ::error consumeFace(Stream& stream) noexcept
+		{
+			// exporters stick to one face format per file, so the first vertex of a face picks the
+			// parser for all following faces until one of them does not match
+			if (!face_format)
+				face_format = stream.detectFaceFormat();
+
+			bool matched = false;
+			auto ret = OBJ::error::SUCCESS;
+
+			switch (*face_format)
+			{
+			case parse::FaceFormat::V:
+				ret = consumeFaceAs<parse::FaceFormat::V>(stream, matched);
+				break;
+			case parse::FaceFormat::VT:
+				ret = consumeFaceAs<parse::FaceFormat::VT>(stream, matched);
+				break;
+			case parse::FaceFormat::VN:
+				ret = consumeFaceAs<parse::FaceFormat::VN>(stream, matched);
+				break;
+			case parse::FaceFormat::VTN:
+				ret = consumeFaceAs<parse::FaceFormat::VTN>(stream, matched);
+				break;
+			}
+
+			if (!matched)
+				face_format.reset();
+
+			return ret;
+		}
+
+		[[nodiscard]]
+		OBJ::error consumeObjectName(Stream& stream) noexcept
 		{
 			if (auto name = stream.expectNonWS())
 			{
@@ -129,7 +207,7 @@ namespace OBJ
 		}
 
 		[[nodiscard]]
-		OBJ::error consumeGroupName(OBJ::Stream& stream) noexcept
+		OBJ::error consumeGroupName(Stream& stream) noexcept
 		{
 			do
 			{
@@ -146,13 +224,13 @@ namespace OBJ
 		}
 
 		[[nodiscard]]
-		OBJ::error consumeSmoothingGroup(OBJ::Stream& stream) noexcept
+		OBJ::error consumeSmoothingGroup(Stream& stream) noexcept
 		{
 			int n;
 
 			if (!stream.consumeInteger(n))
 			{
-				if (stream.consume<'o', 'f', 'f'>())
+				if (stream.template consume<'o', 'f', 'f'>())
 				{
 					n = 0;
 				}
@@ -170,7 +248,7 @@ namespace OBJ
 		}
 
 		[[nodiscard]]
-		OBJ::error consumeMtlLib(OBJ::Stream& stream) noexcept
+		OBJ::error consumeMtlLib(Stream& stream) noexcept
 		{
 			if (auto name = stream.expectNonWS(); name && stream.expectLineEnd())
 				return consumer.consumeMtlLib(stream, *name);
@@ -178,117 +256,184 @@ namespace OBJ
 		}
 
 		[[nodiscard]]
-		OBJ::error consumeUseMtl(OBJ::Stream& stream) noexcept
+		OBJ::error consumeUseMtl(Stream& stream) noexcept
 		{
 			if (auto name = stream.expectNonWS(); name && stream.expectLineEnd())
 				return consumer.consumeUseMtl(stream, *name);
 			return OBJ::error::SYNTAX_ERROR;
 		}
 
+		// statements of attributes that the consumer does not read are skipped without parsing them
+		[[nodiscard]]
+		OBJ::error skipStatement(Stream& stream) noexcept
+		{
+			stream.skipLine();
+			return OBJ::error::SUCCESS;
+		}
+
+		template <typename T, typename Deliver>
+		[[nodiscard]]
+		static OBJ::error flushBatch(batch<T>& b, Deliver&& deliver) noexcept
+		{
+			if (b.size == 0)
+				return OBJ::error::SUCCESS;
+
+			auto count = b.size;
+			b.size = 0;
+			return deliver(b.elements, count);
+		}
+
 	public:
 		Reader(Consumer& consumer) noexcept
 			: consumer(consumer)
 		{
 		}
 
+		// the emit functions hand parsed elements to the consumer, holding them back in batches if it accepts them
+
 		[[nodiscard]]
-		OBJ::error consume(OBJ::Stream& stream, char c) noexcept
+		OBJ::error emitVertex(Stream& stream, float x, float y, float z) noexcept
 		{
-			switch (c)
+			if constexpr (batched)
 			{
-			case 'v':
-				if (stream.consumeHorizontalWS())
-				{
-					if (auto ret = consumeVertex(stream); ret != OBJ::error::SUCCESS)
-						return ret;
-					break;
-				}
-				else if (stream.consume<'n'>())
-				{
-					if (stream.consumeHorizontalWS())
-					{
-						if (auto ret = consumeNormal(stream); ret != OBJ::error::SUCCESS)
-							return ret;
-						break;
-					}
-				}
-				else if (stream.consume<'t'>())
-				{
-					if (stream.consumeHorizontalWS())
-					{
-						if (auto ret = consumeTexcoord(stream); ret != OBJ::error::SUCCESS)
-							return ret;
-						break;
-					}
-				}
-				[[fallthrough]];
+				vertices.elements[vertices.size++] = { x, y, z };
+				return vertices.size == BATCH_SIZE ? flush(stream) : OBJ::error::SUCCESS;
+			}
+			else
+				return consumer.consumeVertex(stream, x, y, z);
+		}
 
-			case 'f':
-				if (stream.consumeHorizontalWS())
-				{
-					if (auto ret = consumeFace(stream); ret != OBJ::error::SUCCESS)
-						return ret;
-					break;
-				}
-				[[fallthrough]];
+		[[nodiscard]]
+		OBJ::error emitVertex(Stream& stream, float x, float y, float z, float w) noexcept
+		{
+			if (auto ret = flush(stream); ret != OBJ::error::SUCCESS)
+				return ret;
+			return consumer.consumeVertex(stream, x, y, z, w);
+		}
 
-			case 'o':
-				if (stream.consumeHorizontalWS())
-				{
-					if (auto ret = consumeObjectName(stream); ret != OBJ::error::SUCCESS)
-						return ret;
-					break;
-				}
-				[[fallthrough]];
+		[[nodiscard]]
+		OBJ::error emitNormal(Stream& stream, float x, float y, float z) noexcept
+		{
+			if constexpr (batched)
+			{
+				normals.elements[normals.size++] = { x, y, z };
+				return normals.size == BATCH_SIZE ? flush(stream) : OBJ::error::SUCCESS;
+			}
+			else
+				return consumer.consumeNormal(stream, x, y, z);
+		}
 
-			case 'g':
-				if (stream.consumeHorizontalWS())
-				{
-					if (auto ret = consumeGroupName(stream); ret != OBJ::error::SUCCESS)
-						return ret;
-					break;
-				}
-				[[fallthrough]];
+		[[nodiscard]]
+		OBJ::error emitTexcoord(Stream& stream, float u) noexcept
+		{
+			if (auto ret = flush(stream); ret != OBJ::error::SUCCESS)
+				return ret;
+			return consumer.consumeTexcoord(stream, u);
+		}
 
-			case 's':
-				if (stream.consumeHorizontalWS())
-				{
-					if (auto ret = consumeSmoothingGroup(stream); ret != OBJ::error::SUCCESS)
-						return ret;
-					break;
-				}
-				[[fallthrough]];
+		[[nodiscard]]
+		OBJ::error emitTexcoord(Stream& stream, float u, float v) noexcept
+		{
+			if constexpr (batched)
+			{
+				texcoords.elements[texcoords.size++] = { u, v };
+				return texcoords.size == BATCH_SIZE ? flush(stream) : OBJ::error::SUCCESS;
+			}
+			else
+				return consumer.consumeTexcoord(stream, u, v);
+		}
 
-			case 'm':
-				if (stream.consume<'t', 'l', 'l', 'i', 'b'>())
-				{
-					if (stream.consumeHorizontalWS())
-						if (auto ret = consumeMtlLib(stream); ret != OBJ::error::SUCCESS)
-							return ret;
-					break;
-				}
-				[[fallthrough]];
+		[[nodiscard]]
+		OBJ::error emitTexcoord(Stream& stream, float u, float v, float w) noexcept
+		{
+			if (auto ret = flush(stream); ret != OBJ::error::SUCCESS)
+				return ret;
+			return consumer.consumeTexcoord(stream, u, v, w);
+		}
 
-			case 'u':
-				if (stream.consume<'s', 'e', 'm', 't', 'l'>())
-				{
-					if (stream.consumeHorizontalWS())
-						if (auto ret = consumeUseMtl(stream); ret != OBJ::error::SUCCESS)
-							return ret;
-					break;
-				}
-				[[fallthrough]];
+		// vertex attributes have to be flushed before the first vertex of a face is emitted
+		[[nodiscard]]
+		OBJ::error emitFaceVertex(Stream& stream, index_type v, index_type n, index_type t) noexcept
+		{
+			if constexpr (batched)
+			{
+				face_vertices.elements[face_vertices.size++] = { v, n, t };
+				return face_vertices.size == BATCH_SIZE ? flushFaceVertices(stream) : OBJ::error::SUCCESS;
+			}
+			else
+				return consumer.consumeFaceVertex(stream, v, n, t);
+		}
 
-			default:
-				stream.error("unknown command");
-				return OBJ::error::SYNTAX_ERROR;
+		// hands over batched vertex attributes
+		[[nodiscard]]
+		OBJ::error flush(Stream& stream) noexcept
+		{
+			if constexpr (batched)
+			{
+				if (auto ret = flushBatch(vertices, [&](const float3* elements, std::size_t count) noexcept { return consumer.consumeVertices(stream, elements, count); }); ret != OBJ::error::SUCCESS)
+					return ret;
+				if (auto ret = flushBatch(normals, [&](const float3* elements, std::size_t count) noexcept { return consumer.consumeNormals(stream, elements, count); }); ret != OBJ::error::SUCCESS)
+					return ret;
+				return flushBatch(texcoords, [&](const float2* elements, std::size_t count) noexcept { return consumer.consumeTexcoords(stream, elements, count); });
+			}
+			else
+				return OBJ::error::SUCCESS;
+		}
+
+		// hands over the batched vertices of the current face
+		[[nodiscard]]
+		OBJ::error flushFaceVertices(Stream& stream) noexcept
+		{
+			if constexpr (batched)
+				return flushBatch(face_vertices, [&](const basic_face_vertex<index_type>* elements, std::size_t count) noexcept { return consumer.consumeFaceVertices(stream, elements, static_cast<int>(count)); });
+			else
+				return OBJ::error::SUCCESS;
+		}
 
-			case '#':
+		[[nodiscard]]
+		OBJ::error finish(Stream& stream) noexcept
+		{
+			return flush(stream);
+		}
+
+		[[nodiscard]]
+		OBJ::error consume(Stream& stream, char c) noexcept
+		{
+			if (c == '#')
+			{
 				stream.skipLine();
-				break;
+				return OBJ::error::SUCCESS;
 			}
 
-			return OBJ::error::SUCCESS;
+			static constexpr parse::keyword_table<command> commands = {{
+				{ "v", { &Reader::consumeVertex, true } },
+				{ "vn", { reads(attributes, Attributes::NORMALS) ? &Reader::consumeNormal : &Reader::skipStatement, true } },
+				{ "vt", { reads(attributes, Attributes::TEXCOORDS) ? &Reader::consumeTexcoord : &Reader::skipStatement, true } },
+				{ "f", { &Reader::consumeFace } },
+				{ "o", { &Reader::consumeObjectName } },
+				{ "g", { &Reader::consumeGroupName } },
+				{ "s", { &Reader::consumeSmoothingGroup } },
+				{ "mtllib", { &Reader::consumeMtlLib, false, true } },
+				{ "usemtl", { &Reader::consumeUseMtl, false, true } },
+			}};
+			static_assert(commands.perfect());
+
+			auto cmd = commands.find(stream.consumeCommand());
+
+			if (!cmd || !cmd->attribute)
+			{
+				if (auto ret = flush(stream); ret != OBJ::error::SUCCESS)
+					return ret;
+			}
+
+			if (cmd && stream.consumeHorizontalWS())
+				return (this->*cmd->consume)(stream);
+
+			if (cmd && cmd->ignore_without_arguments)
+				return OBJ::error::SUCCESS;
+
+			stream.error("unknown command");
+			return OBJ::error::SYNTAX_ERROR;
 		}
 	};
 }
@@ -1,252 +1,376 @@
-#ifndef INCLUDED_OBJ_STREAM
-#define INCLUDED_OBJ_STREAM
-
-#pragma once
-
-#include <utility>
-#include <cstdlib>
-#include <charconv>
-#include <string_view>
-#include <optional>
-#include <cstdio>
-
-#include "obj.h"
-
-
-namespace OBJ
-{
-	class Stream
-	{
-		const char* ptr;
-		const char* end;
-		float size;
-		int line = 1;
-		const char* name;
-
-		StreamCallback& callback;
-
-
-		static constexpr bool isHorizontalWS(char c)
-		{
-			return c == ' ' || c == '\t' || c == '\r';
-		}
-
-		static constexpr bool isVerticalWS(char c)
-		{
-			return c == '\n' || c == '\v' || c == '\f';
-		}
-
-		static constexpr bool isWS(char c)
-		{
-			return isHorizontalWS(c) || isVerticalWS(c);
-		}
-
-		void endLine() noexcept
-		{
-			if (line % 0x4000 == 0)
-				callback.progress(1.0f - (end - ptr) / size);
-			++line;
-		}
-
-		void endFile() noexcept
-		{
-			callback.finish();
-		}
-
-	public:
-		Stream(const char* begin, const char* end, const char* name, StreamCallback& callback) noexcept
-			: ptr(begin), end(end), size(static_cast<float>(end - begin)), name(name), callback(callback)
-		{
-		}
-
-		void error(const char* msg) const
-		{
-			callback.error(name, line, msg);
-		}
-
-		void warn(const char* msg) const
-		{
-			callback.warning(name, line, msg);
-		}
-
-		bool skipLine() noexcept
-		{
-			while (ptr != end)
-			{
-				if (*ptr++ == '\n')
-				{
-					endLine();
-					return true;
-				}
-			}
-			return false;
-		}
-
-		template <char... C>
-		bool consume() noexcept
-		{
-			static_assert(sizeof...(C) > 0);
-			static_assert(((!isWS(C)) && ...), "consume does not support whitespace characters");
-
-			if (auto c = ptr; ptr + sizeof...(C) < end && ((*c++ == C) && ...))
-			{
-				ptr = c;
-				return true;
-			}
-			return false;
-		}
-
-		bool consumeHorizontalWS() noexcept
-		{
-			if (ptr == end || (*ptr != ' ' && *ptr != '\t' && *ptr != '\r'))
-				return false;
-
-			do ++ptr; while (ptr != end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r'));
-
-			return true;
-		}
-
-		[[nodiscard]]
-		bool expectHorizontalWS() noexcept
-		{
-			if (!consumeHorizontalWS())
-			{
-				error("expected horizontal white space");
-				return false;
-			}
-
-			return true;
-		}
-
-		bool finishLine() noexcept
-		{
-			consumeHorizontalWS();
-
-			if (ptr == end)
-				return true;
-
-			if (*ptr == '\n')
-			{
-				++ptr;
-				endLine();
-				return true;
-			}
-
-			return false;
-		}
-
-		[[nodiscard]]
-		bool expectLineEnd() noexcept
-		{
-			if (!finishLine())
-			{
-				error("expected newline");
-				return false;
-			}
-
-			return true;
-		}
-
-		std::string_view consumeNonWS() noexcept
-		{
-			auto begin = ptr;
-			while (ptr != end && *ptr != ' ' && *ptr != '\t' && *ptr != '\r' && *ptr != '\n')
-				++ptr;
-			return { begin, static_cast<std::size_t>(ptr - begin) };
-		}
-
-		[[nodiscard]]
-		std::optional<std::string_view> expectNonWS() noexcept
-		{
-			auto v = consumeNonWS();
-			if (v.empty())
-			{
-				error("expected string");
-				return {};
-			}
-			return v;
-		}
-
-		//[[nodiscard]]
-		bool consumeInteger(int& n)
-		{
-			auto [token_end, err] = std::from_chars(ptr, end, n);
-
-			if (err != std::errc())
-			{
-				if (err == std::errc::result_out_of_range)
-					error("integer out of range");
-				return false;
-			}
-
-			ptr = token_end;
-
-			return true;
-		}
-
-		[[nodiscard]]
-		std::optional<int> expectInteger()
-		{
-			if (int n; consumeInteger(n))
-				return n;
-			error("expected integer");
-			return {};
-		}
-
-		//[[nodiscard]]
-		bool consumeFloat(float& f)
-		{
-			auto [token_end, err] = std::from_chars(ptr, end, f);
-
-			if (err != std::errc())
-			{
-				if (err == std::errc::result_out_of_range)
-					error("floating point number out of range");
-				return false;
-			}
-
-			ptr = token_end;
-
-			return true;
-		}
-
-		[[nodiscard]]
-		std::optional<float> expectFloat()
-		{
-			if (float f; consumeFloat(f))
-				return f;
-			error("expected floating point number");
-			return {};
-		}
-
-		template <typename Consumer>
-		[[nodiscard]]
-		OBJ::error consume(Consumer&& consumer) noexcept
-		{
-			while (ptr != end)
-			{
-				char c = *ptr++;
-
-				switch (c)
-				{
-				case '\n':
-					endLine();
-				case '\r':
-				case '\t':
-				case ' ':
-					break;
-
-				default:
-					if (auto ret = consumer.consume(*this, c); ret != OBJ::error::SUCCESS)
-						return ret;
-					break;
-				}
-			}
-
-			endFile();
-			return OBJ::error::SUCCESS;
-		}
-	};
-}
-
-#endif  // INCLUDED_OBJ_STREAM
+#ifndef INCLUDED_OBJ_STREAM
+#define INCLUDED_OBJ_STREAM
+
+#pragma once
+
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <charconv>
+#include <string_view>
+#include <optional>
+#include <cstdio>
+
+#include <parse/scan.h>
+#include <parse/kernels.h>
+#include <parse/integer.h>
+#include <parse/float.h>
+
+#include "obj.h"
+
+
+namespace OBJ
+{
+	// Callback is a compile-time policy with the member functions of StreamCallback, which is itself
+	// the policy that dispatches them at runtime
+	template <typename Callback>
+	class BasicStream
+	{
+	protected:
+		static constexpr std::ptrdiff_t PROGRESS_INTERVAL = 1 << 19;
+
+		const char* ptr;
+		const char* end;
+		std::size_t size;
+		const char* next_progress;
+		const char* name;
+
+		// lines are not counted while parsing, line is the number of the line that counted is on
+		mutable const char* counted;
+		mutable std::int64_t line = 1;
+
+		Callback& callback;
+
+
+		static constexpr bool isHorizontalWS(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		static constexpr bool isVerticalWS(char c)
+		{
+			return c == '\n' || c == '\v' || c == '\f';
+		}
+
+		static constexpr bool isWS(char c)
+		{
+			return isHorizontalWS(c) || isVerticalWS(c);
+		}
+
+		void reportProgress() noexcept
+		{
+			// the fraction is only formed from the exact byte counts, which a float would round on large files
+			auto done = size - static_cast<std::size_t>(end - ptr);
+			callback.progress(static_cast<float>(static_cast<double>(done) / static_cast<double>(size)));
+			next_progress = end - ptr > PROGRESS_INTERVAL ? ptr + PROGRESS_INTERVAL : end;
+		}
+
+		void endFile() noexcept
+		{
+			callback.finish();
+		}
+
+	public:
+		BasicStream(const char* begin, const char* end, const char* name, Callback& callback) noexcept
+			: ptr(begin), end(end), size(static_cast<std::size_t>(end - begin)), next_progress(end - begin > PROGRESS_INTERVAL ? begin + PROGRESS_INTERVAL : end), name(name), counted(begin), callback(callback)
+		{
+		}
+
+		void error(const char* msg) const
+		{
+			callback.error(name, lineNumber(), msg);
+		}
+
+		void warn(const char* msg) const
+		{
+			callback.warning(name, lineNumber(), msg);
+		}
+
+		// finds the current line by counting the newlines since the last time it was asked for
+		std::int64_t lineNumber() const noexcept
+		{
+			line += static_cast<std::int64_t>(parse::activeKernels().countNewlines(counted, ptr));
+			counted = ptr;
+			return line;
+		}
+
+		const char* position() const noexcept
+		{
+			return ptr;
+		}
+
+		const char* limit() const noexcept
+		{
+			return end;
+		}
+
+		// moves the stream forward to p
+		void advance(const char* p) noexcept
+		{
+			ptr = p;
+		}
+
+		// returns the command word that starts with the character consumed last and moves past it
+		std::string_view consumeCommand()
+		{
+			auto begin = ptr - 1;
+
+			while (ptr != end && !isWS(*ptr))
+				++ptr;
+
+			return { begin, static_cast<std::size_t>(ptr - begin) };
+		}
+
+		bool skipLine() noexcept
+		{
+			ptr = parse::activeKernels().findNewline(ptr, end);
+
+			if (ptr == end)
+				return false;
+
+			++ptr;
+			return true;
+		}
+
+		template <char... C>
+		bool consume() noexcept
+		{
+			static_assert(sizeof...(C) > 0);
+			static_assert(((!isWS(C)) && ...), "consume does not support whitespace characters");
+
+			if (auto c = ptr; ptr + sizeof...(C) < end && ((*c++ == C) && ...))
+			{
+				ptr = c;
+				return true;
+			}
+			return false;
+		}
+
+		bool consumeHorizontalWS() noexcept
+		{
+			if (ptr == end || (*ptr != ' ' && *ptr != '\t' && *ptr != '\r'))
+				return false;
+
+			ptr = parse::scan::findFirstNotOf<' ', '\t', '\r'>(ptr + 1, end);
+
+			return true;
+		}
+
+		[[nodiscard]]
+		bool expectHorizontalWS() noexcept
+		{
+			if (!consumeHorizontalWS())
+			{
+				error("expected horizontal white space");
+				return false;
+			}
+
+			return true;
+		}
+
+		// tells whether only horizontal white space is left on the line, without consuming the newline
+		bool atLineEnd() noexcept
+		{
+			consumeHorizontalWS();
+			return ptr == end || *ptr == '\n';
+		}
+
+		bool finishLine() noexcept
+		{
+			consumeHorizontalWS();
+
+			if (ptr == end)
+				return true;
+
+			if (*ptr == '\n')
+			{
+				++ptr;
+				return true;
+			}
+
+			return false;
+		}
+
+		[[nodiscard]]
+		bool expectLineEnd() noexcept
+		{
+			if (!finishLine())
+			{
+				error("expected newline");
+				return false;
+			}
+
+			return true;
+		}
+
+		std::string_view consumeNonWS() noexcept
+		{
+			auto begin = ptr;
+			ptr = parse::scan::findFirstOf<' ', '\t', '\r', '\n'>(ptr, end);
+			return { begin, static_cast<std::size_t>(ptr - begin) };
+		}
+
+		[[nodiscard]]
+		std::optional<std::string_view> expectNonWS() noexcept
+		{
+			auto v = consumeNonWS();
+			if (v.empty())
+			{
+				error("expected string");
+				return {};
+			}
+			return v;
+		}
+
+		//[[nodiscard]]
+		template <typename T>
+		bool consumeInteger(T& n)
+		{
+			auto [token_end, err] = parse::parseInteger(ptr, end, n);
+
+			if (err != std::errc())
+			{
+				if (err == std::errc::result_out_of_range)
+					error("integer out of range");
+				return false;
+			}
+
+			ptr = token_end;
+
+			return true;
+		}
+
+		template <typename T = int>
+		[[nodiscard]]
+		std::optional<T> expectInteger()
+		{
+			if (T n; consumeInteger(n))
+				return n;
+			error("expected integer");
+			return {};
+		}
+
+		// consumes a face vertex only if it has the slots of format F, leaves anything else to expectFaceVertex
+		template <parse::FaceFormat F, typename T>
+		bool consumeFaceVertex(T& v, T& n, T& t)
+		{
+			if (auto [token_end, err] = parse::parseFaceVertexAs<F>(ptr, end, v, n, t); err == std::errc() && token_end != end)
+			{
+				ptr = token_end;
+				return true;
+			}
+			return false;
+		}
+
+		parse::FaceFormat detectFaceFormat() const
+		{
+			return parse::detectFaceFormat(ptr, end);
+		}
+
+		template <typename T>
+		[[nodiscard]]
+		bool expectFaceVertex(T& v, T& n, T& t)
+		{
+			// consume<'/'>() never matches the last character of the input, so a vertex that runs up to the end takes the long way
+			if (auto [token_end, err] = parse::parseFaceVertex(ptr, end, v, n, t); err == std::errc() && token_end != end)
+			{
+				ptr = token_end;
+				return true;
+			}
+
+			auto vi = expectInteger<T>();
+
+			if (!vi)
+				return false;
+
+			v = *vi;
+			t = 0;
+			n = 0;
+
+			if (consume<'/'>())
+			{
+				consumeInteger(t);
+
+				if (consume<'/'>())
+					consumeInteger(n);
+			}
+
+			return true;
+		}
+
+		//[[nodiscard]]
+		bool consumeFloat(float& f)
+		{
+			auto [token_end, err] = parse::parseFloat(ptr, end, f);
+
+			if (err != std::errc())
+			{
+				if (err == std::errc::result_out_of_range)
+					error("floating point number out of range");
+				return false;
+			}
+
+			ptr = token_end;
+
+			return true;
+		}
+
+		[[nodiscard]]
+		std::optional<float> expectFloat()
+		{
+			if (float f; consumeFloat(f))
+				return f;
+			error("expected floating point number");
+			return {};
+		}
+
+	protected:
+		// hands the statements up to end to the consumer; progress is reported through self, so that streams
+		// built on this one (see obj_block_stream.h) can tell how far along they are
+		template <typename Self, typename Consumer>
+		[[nodiscard]]
+		OBJ::error consumeStatements(Self& self, Consumer& consumer) noexcept
+		{
+			while (ptr != end)
+			{
+				if (*ptr == ' ' || *ptr == '\t' || *ptr == '\r' || *ptr == '\n')
+				{
+					ptr = parse::scan::findFirstNotOf<' ', '\t', '\r', '\n'>(ptr, end);
+
+					if (ptr == end)
+						break;
+				}
+
+				if (ptr >= next_progress)
+					self.reportProgress();
+
+				char c = *ptr++;
+
+				if (auto ret = consumer.consume(self, c); ret != OBJ::error::SUCCESS)
+					return ret;
+			}
+
+			return OBJ::error::SUCCESS;
+		}
+
+	public:
+		template <typename Consumer>
+		[[nodiscard]]
+		OBJ::error consume(Consumer&& consumer) noexcept
+		{
+			if (auto ret = consumeStatements(*this, consumer); ret != OBJ::error::SUCCESS)
+				return ret;
+
+			if (auto ret = consumer.finish(*this); ret != OBJ::error::SUCCESS)
+				return ret;
+
+			endFile();
+			return OBJ::error::SUCCESS;
+		}
+	};
+
+	using Stream = BasicStream<StreamCallback>;
+}
+
+#endif  // INCLUDED_OBJ_STREAM
@@ -11,14 +11,14 @@ namespace OBJ
 		fflush(stdout);
 	}
 
-	void StdoutStreamCallback::warning(const char* file, int line, const char* msg) noexcept
+	void StdoutStreamCallback::warning(const char* file, std::int64_t line, const char* msg) noexcept
 	{
-		fprintf(stderr, "%s(%d): error: %s\n", file, line, msg);
+		fprintf(stderr, "%s(%lld): error: %s\n", file, static_cast<long long>(line), msg);
 	}
 
-	void StdoutStreamCallback::error(const char* file, int line, const char* msg) noexcept
+	void StdoutStreamCallback::error(const char* file, std::int64_t line, const char* msg) noexcept
 	{
-		fprintf(stderr, "%s(%d): warning: %s\n", file, line, msg);
+		fprintf(stderr, "%s(%lld): warning: %s\n", file, static_cast<long long>(line), msg);
 	}
 
 	void StdoutStreamCallback::finish() noexcept
@@ -11,8 +11,8 @@ namespace OBJ
 	struct StdoutStreamCallback : virtual StreamCallback
 	{
 		virtual void progress(float progress) noexcept override;
-		virtual void warning(const char* file, int line, const char* msg) noexcept override;
-		virtual void error(const char* file, int line, const char* msg) noexcept override;
+		virtual void warning(const char* file, std::int64_t line, const char* msg) noexcept override;
+		virtual void error(const char* file, std::int64_t line, const char* msg) noexcept override;
 		virtual void finish() noexcept override;
 	};
 }
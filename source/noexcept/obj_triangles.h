@@ -0,0 +1,112 @@
+#ifndef INCLUDED_OBJ_TRIANGLES
+#define INCLUDED_OBJ_TRIANGLES
+
+#pragma once
+
+#include <type_traits>
+
+#include "obj_stream.h"
+#include "obj_block_stream.h"
+#include "obj_reader.h"
+#include "obj_indexed_reader.h"
+#include "obj_consumer.h"
+#include "obj_parallel.h"
+#include "obj.h"
+
+
+namespace OBJ
+{
+	// exposes a callback policy through the virtual StreamCallback interface, for the parts that are not templates
+	template <typename Callback>
+	class StreamCallbackAdapter : public StreamCallback
+	{
+		Callback& callback;
+
+	public:
+		StreamCallbackAdapter(Callback& callback) noexcept
+			: callback(callback)
+		{
+		}
+
+		void progress(float progress) noexcept override
+		{
+			callback.progress(progress);
+		}
+
+		void warning(const char* file, std::int64_t line, const char* msg) noexcept override
+		{
+			callback.warning(file, line, msg);
+		}
+
+		void error(const char* file, std::int64_t line, const char* msg) noexcept override
+		{
+			callback.error(file, line, msg);
+		}
+
+		void finish() noexcept override
+		{
+			callback.finish();
+		}
+	};
+
+	template <Attributes A, typename Index, typename Stream>
+	error consumeTriangles(BasicTriangles<A, Index>& out, Stream& stream, const ReadOptions& options) noexcept
+	{
+		BasicOBJConsumer<A, Index> consumer(options.hash_seed);
+
+		if (options.engine == Engine::INDEXED)
+		{
+			IndexedReader<BasicOBJConsumer<A, Index>, Stream> reader(consumer);
+			if (error err = stream.consume(reader); err != error::SUCCESS)
+				return err;
+		}
+		else
+		{
+			Reader<BasicOBJConsumer<A, Index>, Stream> reader(consumer);
+			if (error err = stream.consume(reader); err != error::SUCCESS)
+				return err;
+		}
+
+		if (error err = consumer.mergeFaces(); err != error::SUCCESS)
+			return err;
+
+		out = consumer.finish();
+		return error::SUCCESS;
+	}
+
+	template <Attributes A, typename Index, typename Callback>
+	error readTrianglesSerial(BasicTriangles<A, Index>& out, const char* begin, const char* end, const char* name, Callback& stream_callback, const ReadOptions& options) noexcept
+	{
+		BasicStream<Callback> stream(begin, end, name, stream_callback);
+		return consumeTriangles(out, stream, options);
+	}
+
+	template <Attributes A, typename Index, typename Callback>
+	error readTrianglesStreamed(BasicTriangles<A, Index>& out, ReadCallback& input, const char* name, Callback& stream_callback, const ReadOptions& options) noexcept
+	{
+		BasicBlockStream<Callback> stream(input, options.block_size, name, stream_callback);
+		return consumeTriangles(out, stream, options);
+	}
+
+	// readTriangles that reads only the vertex attributes A besides positions, or that takes a callback policy other than
+	// StreamCallback, whose calls are resolved at compile time; only the parallel path, which reports from the calling
+	// thread once all chunks are done, goes through an adapter for such a policy
+	template <Attributes A, typename Index, typename Callback, typename = std::enable_if_t<A != Attributes::ALL || !std::is_same_v<Index, int> || !std::is_base_of_v<StreamCallback, Callback>>>
+	error readTriangles(BasicTriangles<A, Index>& out, const char* begin, const char* end, const char* name, Callback& stream_callback, const ReadOptions& options = {}) noexcept
+	{
+		if (int num_chunks = parallelChunkCount(end - begin, options.num_threads); num_chunks > 1)
+		{
+			if constexpr (std::is_base_of_v<StreamCallback, Callback>)
+				return readTrianglesParallel(out, begin, end, name, stream_callback, num_chunks, options);
+			else
+			{
+				StreamCallbackAdapter<Callback> adapter(stream_callback);
+				return readTrianglesParallel(out, begin, end, name, adapter, num_chunks, options);
+			}
+		}
+
+		return readTrianglesSerial(out, begin, end, name, stream_callback, options);
+	}
+}
+
+#endif  // INCLUDED_OBJ_TRIANGLES
@@ -0,0 +1,90 @@
+#ifndef INCLUDED_PARSE_BITS
+#define INCLUDED_PARSE_BITS
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace parse
+{
+	inline int countTrailingZeros(std::uint32_t x) noexcept
+	{
+#if defined(_MSC_VER)
+		unsigned long i;
+		_BitScanForward(&i, x);
+		return static_cast<int>(i);
+#else
+		return __builtin_ctz(x);
+#endif
+	}
+
+	inline int countTrailingZeros(std::uint64_t x) noexcept
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long i;
+		_BitScanForward64(&i, x);
+		return static_cast<int>(i);
+#elif defined(_MSC_VER)
+		auto lo = static_cast<std::uint32_t>(x);
+		return lo ? countTrailingZeros(lo) : 32 + countTrailingZeros(static_cast<std::uint32_t>(x >> 32));
+#else
+		return __builtin_ctzll(x);
+#endif
+	}
+
+	inline int countLeadingZeros(std::uint64_t x) noexcept
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long i;
+		_BitScanReverse64(&i, x);
+		return 63 - static_cast<int>(i);
+#elif defined(_MSC_VER)
+		unsigned long i;
+		if (_BitScanReverse(&i, static_cast<std::uint32_t>(x >> 32)))
+			return 31 - static_cast<int>(i);
+		_BitScanReverse(&i, static_cast<std::uint32_t>(x));
+		return 63 - static_cast<int>(i);
+#else
+		return __builtin_clzll(x);
+#endif
+	}
+
+	inline int popCount(std::uint32_t x) noexcept
+	{
+#if defined(_MSC_VER)
+		return static_cast<int>(__popcnt(x));
+#else
+		return __builtin_popcount(x);
+#endif
+	}
+
+	inline int popCount(std::uint64_t x) noexcept
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		return static_cast<int>(__popcnt64(x));
+#elif defined(_MSC_VER)
+		return popCount(static_cast<std::uint32_t>(x)) + popCount(static_cast<std::uint32_t>(x >> 32));
+#else
+		return __builtin_popcountll(x);
+#endif
+	}
+
+	// asks for the cache line at p to be loaded ahead of being read; p does not have to be valid
+	inline void prefetch(const void* p) noexcept
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		_mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#elif defined(_MSC_VER)
+		__prefetch(p);
+#else
+		__builtin_prefetch(p);
+#endif
+	}
+}
+
+#endif  // INCLUDED_PARSE_BITS
@@ -0,0 +1,261 @@
+#ifndef INCLUDED_PARSE_FLOAT
+#define INCLUDED_PARSE_FLOAT
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cfloat>
+#include <charconv>
+
+#include "bits.h"
+
+
+namespace parse
+{
+	namespace detail
+	{
+		struct uint128
+		{
+			std::uint64_t high;
+			std::uint64_t low;
+		};
+
+		inline uint128 multiply(std::uint64_t a, std::uint64_t b) noexcept
+		{
+#if defined(__SIZEOF_INT128__)
+			auto r = static_cast<unsigned __int128>(a) * b;
+			return { static_cast<std::uint64_t>(r >> 64), static_cast<std::uint64_t>(r) };
+#elif defined(_MSC_VER) && defined(_M_X64)
+			std::uint64_t high;
+			std::uint64_t low = _umul128(a, b, &high);
+			return { high, low };
+#else
+			std::uint64_t a_lo = static_cast<std::uint32_t>(a), a_hi = a >> 32;
+			std::uint64_t b_lo = static_cast<std::uint32_t>(b), b_hi = b >> 32;
+			std::uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+			std::uint64_t cross = (lo_lo >> 32) + static_cast<std::uint32_t>(hi_lo) + lo_hi;
+			return { hi_hi + (hi_lo >> 32) + (cross >> 32), (cross << 32) | static_cast<std::uint32_t>(lo_lo) };
+#endif
+		}
+
+		// 128-bit truncated approximations of 5^q for the decimal exponents that can yield a normal float
+		constexpr int SMALLEST_POWER_OF_TEN = -65;
+		constexpr int LARGEST_POWER_OF_TEN = 38;
+
+		constexpr uint128 POWERS_OF_FIVE[] = {
+			{ 0x86CCBB52EA94BAEAULL, 0x98E947129FC2B4E9ULL }, { 0xA87FEA27A539E9A5ULL, 0x3F2398D747B36224ULL },
+			{ 0xD29FE4B18E88640EULL, 0x8EEC7F0D19A03AADULL }, { 0x83A3EEEEF9153E89ULL, 0x1953CF68300424ACULL },
+			{ 0xA48CEAAAB75A8E2BULL, 0x5FA8C3423C052DD7ULL }, { 0xCDB02555653131B6ULL, 0x3792F412CB06794DULL },
+			{ 0x808E17555F3EBF11ULL, 0xE2BBD88BBEE40BD0ULL }, { 0xA0B19D2AB70E6ED6ULL, 0x5B6ACEAEAE9D0EC4ULL },
+			{ 0xC8DE047564D20A8BULL, 0xF245825A5A445275ULL }, { 0xFB158592BE068D2EULL, 0xEED6E2F0F0D56712ULL },
+			{ 0x9CED737BB6C4183DULL, 0x55464DD69685606BULL }, { 0xC428D05AA4751E4CULL, 0xAA97E14C3C26B886ULL },
+			{ 0xF53304714D9265DFULL, 0xD53DD99F4B3066A8ULL }, { 0x993FE2C6D07B7FABULL, 0xE546A8038EFE4029ULL },
+			{ 0xBF8FDB78849A5F96ULL, 0xDE98520472BDD033ULL }, { 0xEF73D256A5C0F77CULL, 0x963E66858F6D4440ULL },
+			{ 0x95A8637627989AADULL, 0xDDE7001379A44AA8ULL }, { 0xBB127C53B17EC159ULL, 0x5560C018580D5D52ULL },
+			{ 0xE9D71B689DDE71AFULL, 0xAAB8F01E6E10B4A6ULL }, { 0x9226712162AB070DULL, 0xCAB3961304CA70E8ULL },
+			{ 0xB6B00D69BB55C8D1ULL, 0x3D607B97C5FD0D22ULL }, { 0xE45C10C42A2B3B05ULL, 0x8CB89A7DB77C506AULL },
+			{ 0x8EB98A7A9A5B04E3ULL, 0x77F3608E92ADB242ULL }, { 0xB267ED1940F1C61CULL, 0x55F038B237591ED3ULL },
+			{ 0xDF01E85F912E37A3ULL, 0x6B6C46DEC52F6688ULL }, { 0x8B61313BBABCE2C6ULL, 0x2323AC4B3B3DA015ULL },
+			{ 0xAE397D8AA96C1B77ULL, 0xABEC975E0A0D081AULL }, { 0xD9C7DCED53C72255ULL, 0x96E7BD358C904A21ULL },
+			{ 0x881CEA14545C7575ULL, 0x7E50D64177DA2E54ULL }, { 0xAA242499697392D2ULL, 0xDDE50BD1D5D0B9E9ULL },
+			{ 0xD4AD2DBFC3D07787ULL, 0x955E4EC64B44E864ULL }, { 0x84EC3C97DA624AB4ULL, 0xBD5AF13BEF0B113EULL },
+			{ 0xA6274BBDD0FADD61ULL, 0xECB1AD8AEACDD58EULL }, { 0xCFB11EAD453994BAULL, 0x67DE18EDA5814AF2ULL },
+			{ 0x81CEB32C4B43FCF4ULL, 0x80EACF948770CED7ULL }, { 0xA2425FF75E14FC31ULL, 0xA1258379A94D028DULL },
+			{ 0xCAD2F7F5359A3B3EULL, 0x096EE45813A04330ULL }, { 0xFD87B5F28300CA0DULL, 0x8BCA9D6E188853FCULL },
+			{ 0x9E74D1B791E07E48ULL, 0x775EA264CF55347EULL }, { 0xC612062576589DDAULL, 0x95364AFE032A819EULL },
+			{ 0xF79687AED3EEC551ULL, 0x3A83DDBD83F52205ULL }, { 0x9ABE14CD44753B52ULL, 0xC4926A9672793543ULL },
+			{ 0xC16D9A0095928A27ULL, 0x75B7053C0F178294ULL }, { 0xF1C90080BAF72CB1ULL, 0x5324C68B12DD6339ULL },
+			{ 0x971DA05074DA7BEEULL, 0xD3F6FC16EBCA5E04ULL }, { 0xBCE5086492111AEAULL, 0x88F4BB1CA6BCF585ULL },
+			{ 0xEC1E4A7DB69561A5ULL, 0x2B31E9E3D06C32E6ULL }, { 0x9392EE8E921D5D07ULL, 0x3AFF322E62439FD0ULL },
+			{ 0xB877AA3236A4B449ULL, 0x09BEFEB9FAD487C3ULL }, { 0xE69594BEC44DE15BULL, 0x4C2EBE687989A9B4ULL },
+			{ 0x901D7CF73AB0ACD9ULL, 0x0F9D37014BF60A11ULL }, { 0xB424DC35095CD80FULL, 0x538484C19EF38C95ULL },
+			{ 0xE12E13424BB40E13ULL, 0x2865A5F206B06FBAULL }, { 0x8CBCCC096F5088CBULL, 0xF93F87B7442E45D4ULL },
+			{ 0xAFEBFF0BCB24AAFEULL, 0xF78F69A51539D749ULL }, { 0xDBE6FECEBDEDD5BEULL, 0xB573440E5A884D1CULL },
+			{ 0x89705F4136B4A597ULL, 0x31680A88F8953031ULL }, { 0xABCC77118461CEFCULL, 0xFDC20D2B36BA7C3EULL },
+			{ 0xD6BF94D5E57A42BCULL, 0x3D32907604691B4DULL }, { 0x8637BD05AF6C69B5ULL, 0xA63F9A49C2C1B110ULL },
+			{ 0xA7C5AC471B478423ULL, 0x0FCF80DC33721D54ULL }, { 0xD1B71758E219652BULL, 0xD3C36113404EA4A9ULL },
+			{ 0x83126E978D4FDF3BULL, 0x645A1CAC083126EAULL }, { 0xA3D70A3D70A3D70AULL, 0x3D70A3D70A3D70A4ULL },
+			{ 0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCDULL }, { 0x8000000000000000ULL, 0x0000000000000000ULL },
+			{ 0xA000000000000000ULL, 0x0000000000000000ULL }, { 0xC800000000000000ULL, 0x0000000000000000ULL },
+			{ 0xFA00000000000000ULL, 0x0000000000000000ULL }, { 0x9C40000000000000ULL, 0x0000000000000000ULL },
+			{ 0xC350000000000000ULL, 0x0000000000000000ULL }, { 0xF424000000000000ULL, 0x0000000000000000ULL },
+			{ 0x9896800000000000ULL, 0x0000000000000000ULL }, { 0xBEBC200000000000ULL, 0x0000000000000000ULL },
+			{ 0xEE6B280000000000ULL, 0x0000000000000000ULL }, { 0x9502F90000000000ULL, 0x0000000000000000ULL },
+			{ 0xBA43B74000000000ULL, 0x0000000000000000ULL }, { 0xE8D4A51000000000ULL, 0x0000000000000000ULL },
+			{ 0x9184E72A00000000ULL, 0x0000000000000000ULL }, { 0xB5E620F480000000ULL, 0x0000000000000000ULL },
+			{ 0xE35FA931A0000000ULL, 0x0000000000000000ULL }, { 0x8E1BC9BF04000000ULL, 0x0000000000000000ULL },
+			{ 0xB1A2BC2EC5000000ULL, 0x0000000000000000ULL }, { 0xDE0B6B3A76400000ULL, 0x0000000000000000ULL },
+			{ 0x8AC7230489E80000ULL, 0x0000000000000000ULL }, { 0xAD78EBC5AC620000ULL, 0x0000000000000000ULL },
+			{ 0xD8D726B7177A8000ULL, 0x0000000000000000ULL }, { 0x878678326EAC9000ULL, 0x0000000000000000ULL },
+			{ 0xA968163F0A57B400ULL, 0x0000000000000000ULL }, { 0xD3C21BCECCEDA100ULL, 0x0000000000000000ULL },
+			{ 0x84595161401484A0ULL, 0x0000000000000000ULL }, { 0xA56FA5B99019A5C8ULL, 0x0000000000000000ULL },
+			{ 0xCECB8F27F4200F3AULL, 0x0000000000000000ULL }, { 0x813F3978F8940984ULL, 0x4000000000000000ULL },
+			{ 0xA18F07D736B90BE5ULL, 0x5000000000000000ULL }, { 0xC9F2C9CD04674EDEULL, 0xA400000000000000ULL },
+			{ 0xFC6F7C4045812296ULL, 0x4D00000000000000ULL }, { 0x9DC5ADA82B70B59DULL, 0xF020000000000000ULL },
+			{ 0xC5371912364CE305ULL, 0x6C28000000000000ULL }, { 0xF684DF56C3E01BC6ULL, 0xC732000000000000ULL },
+			{ 0x9A130B963A6C115CULL, 0x3C7F400000000000ULL }, { 0xC097CE7BC90715B3ULL, 0x4B9F100000000000ULL },
+			{ 0xF0BDC21ABB48DB20ULL, 0x1E86D40000000000ULL }, { 0x96769950B50D88F4ULL, 0x1314448000000000ULL },
+		};
+
+		inline bool isDigit(char c) noexcept
+		{
+			return static_cast<unsigned char>(c - '0') < 10;
+		}
+
+		// Eisel-Lemire: computes the correctly rounded float for w * 10^q, returns false if the result would
+		// not be a normal number or if the truncated power of five does not determine the rounding
+		inline bool computeFloat(std::uint32_t& bits, std::int64_t q, std::uint64_t w) noexcept
+		{
+			constexpr int MANTISSA_BITS = 23;
+			constexpr int MINIMUM_EXPONENT = -127;
+			constexpr int INFINITE_POWER = 0xFF;
+
+			if (q < SMALLEST_POWER_OF_TEN || q > LARGEST_POWER_OF_TEN)
+				return false;
+
+			int lz = countLeadingZeros(w);
+			w <<= lz;
+
+			const auto& power = POWERS_OF_FIVE[q - SMALLEST_POWER_OF_TEN];
+			auto product = multiply(w, power.high);
+
+			constexpr std::uint64_t precision_mask = ~std::uint64_t(0) >> (MANTISSA_BITS + 3);
+			if ((product.high & precision_mask) == precision_mask)
+			{
+				auto second = multiply(w, power.low);
+				product.low += second.high;
+				if (second.high > product.low)
+					++product.high;
+
+				if (product.low == ~std::uint64_t(0) && (q < -27 || q > 55))
+					return false;
+			}
+
+			int upperbit = static_cast<int>(product.high >> 63);
+			std::uint64_t mantissa = product.high >> (upperbit + 64 - MANTISSA_BITS - 3);
+			std::int64_t power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz - MINIMUM_EXPONENT;
+
+			if (power2 <= 0)
+				return false;
+
+			// exactly halfway between two floats, round to even
+			if (product.low <= 1 && q >= -17 && q <= 10 && (mantissa & 3) == 1 && (mantissa << (upperbit + 64 - MANTISSA_BITS - 3)) == product.high)
+				mantissa &= ~std::uint64_t(1);
+
+			mantissa += mantissa & 1;
+			mantissa >>= 1;
+
+			if (mantissa >= (std::uint64_t(2) << MANTISSA_BITS))
+			{
+				mantissa = std::uint64_t(1) << MANTISSA_BITS;
+				++power2;
+			}
+
+			mantissa &= ~(std::uint64_t(1) << MANTISSA_BITS);
+
+			if (power2 >= INFINITE_POWER)
+				return false;
+
+			bits = static_cast<std::uint32_t>(mantissa) | (static_cast<std::uint32_t>(power2) << MANTISSA_BITS);
+			return true;
+		}
+	}
+
+	// drop-in replacement for std::from_chars(first, last, value) for floats in the decimal forms found in
+	// OBJ files; anything that is not plain [-]digits[.digits][(e|E)[+|-]digits], has more than 19 significant
+	// digits or does not convert to a normal number goes to std::from_chars, so results and errors are identical
+	inline std::from_chars_result parseFloat(const char* first, const char* last, float& value) noexcept
+	{
+		using detail::isDigit;
+
+		const char* p = first;
+
+		bool negative = p != last && *p == '-';
+		if (negative)
+			++p;
+
+		const char* digits_begin = p;
+		std::uint64_t mantissa = 0;
+
+		for (; p != last && isDigit(*p); ++p)
+			mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+
+		std::int64_t num_digits = p - digits_begin;
+		std::int64_t exponent = 0;
+
+		if (p != last && *p == '.')
+		{
+			const char* fraction_begin = ++p;
+
+			for (; p != last && isDigit(*p); ++p)
+				mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+
+			exponent = fraction_begin - p;
+			num_digits += p - fraction_begin;
+		}
+
+		if (num_digits == 0)
+			return std::from_chars(first, last, value);
+
+		const char* digits_end = p;
+
+		if (p != last && (*p == 'e' || *p == 'E'))
+		{
+			const char* q = p + 1;
+
+			bool negative_exponent = q != last && *q == '-';
+			if (q != last && (*q == '-' || *q == '+'))
+				++q;
+
+			if (q != last && isDigit(*q))
+			{
+				std::int64_t e = 0;
+				for (; q != last && isDigit(*q); ++q)
+					if (e < 0x10000000)
+						e = e * 10 + (*q - '0');
+
+				exponent += negative_exponent ? -e : e;
+				p = q;
+			}
+		}
+
+		if (num_digits > 19)
+		{
+			for (const char* d = digits_begin; d != digits_end && (*d == '0' || *d == '.'); ++d)
+				num_digits -= *d == '0';
+
+			if (num_digits > 19)
+				return std::from_chars(first, last, value);
+		}
+
+		if (mantissa == 0)
+		{
+			value = negative ? -0.0f : 0.0f;
+			return { p, std::errc() };
+		}
+
+#if FLT_EVAL_METHOD == 0
+		// Clinger's fast path: both operands and the result are exact until the final rounding
+		constexpr float powers_of_ten[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+		if (exponent >= -10 && exponent <= 10 && mantissa <= (std::uint64_t(1) << 24))
+		{
+			float f = static_cast<float>(mantissa);
+			f = exponent < 0 ? f / powers_of_ten[-exponent] : f * powers_of_ten[exponent];
+			value = negative ? -f : f;
+			return { p, std::errc() };
+		}
+#endif
+
+		std::uint32_t bits;
+		if (!detail::computeFloat(bits, exponent, mantissa))
+			return std::from_chars(first, last, value);
+
+		bits |= static_cast<std::uint32_t>(negative) << 31;
+		std::memcpy(&value, &bits, sizeof(value));
+		return { p, std::errc() };
+	}
+}
+
+#endif  // INCLUDED_PARSE_FLOAT
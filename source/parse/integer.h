@@ -0,0 +1,239 @@
+#ifndef INCLUDED_PARSE_INTEGER
+#define INCLUDED_PARSE_INTEGER
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <type_traits>
+
+#include "bits.h"
+
+#if !(defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define PARSE_INTEGER_SWAR
+#endif
+
+
+namespace parse
+{
+	namespace detail
+	{
+		inline bool isDecimalDigit(char c) noexcept
+		{
+			return static_cast<unsigned char>(c - '0') < 10;
+		}
+
+#if defined(PARSE_INTEGER_SWAR)
+		// SWAR helpers operate on 8 bytes loaded in memory order, the first character ending up in the lowest byte
+
+		inline std::uint64_t load8(const char* p) noexcept
+		{
+			std::uint64_t x;
+			std::memcpy(&x, p, sizeof(x));
+			return x;
+		}
+
+		// number of digits at the start of the 8 bytes in x
+		inline int countLeadingDigits(std::uint64_t x) noexcept
+		{
+			// a byte is a digit iff its high nibble is 3 and its low nibble does not carry into the high nibble when adding 6
+			std::uint64_t non_digit = ((x & 0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL) | (((x & 0x0F0F0F0F0F0F0F0FULL) + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL);
+			std::uint64_t flags = (((non_digit & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | non_digit) & 0x8080808080808080ULL;
+			return flags ? countTrailingZeros(flags) / 8 : 8;
+		}
+
+		// value of the first n digits in x, 0 < n <= 8
+		inline std::uint32_t decodeDigits(std::uint64_t x, int n) noexcept
+		{
+			// move the digits to the top so that the bytes below them act as leading zeros
+			x = (x - 0x3030303030303030ULL) << (8 * (8 - n));
+			x = x * 10 + (x >> 8);
+			x = (((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) + (((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+			return static_cast<std::uint32_t>(x);
+		}
+#endif
+	}
+
+	// drop-in replacement for std::from_chars(first, last, value) for int and std::int64_t, consuming up to 8 digits per step
+	template <typename T>
+	inline std::from_chars_result parseInteger(const char* first, const char* last, T& value) noexcept
+	{
+		static_assert(std::is_same_v<T, int> || std::is_same_v<T, std::int64_t>);
+
+		// the magnitude of the smallest value of T, one more than that of the largest; anything beyond it saturates
+		constexpr std::uint64_t magnitude = std::uint64_t(1) << (8 * sizeof(T) - 1);
+		constexpr std::uint64_t saturated = magnitude + 1;
+		constexpr std::uint32_t powers_of_ten[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+
+		// a 32-bit value can be scaled by a whole step and saturated afterwards, a 64-bit one has to be checked first
+		constexpr bool wide = sizeof(T) > 4;
+
+		const char* p = first;
+
+		bool negative = p != last && *p == '-';
+		if (negative)
+			++p;
+
+		const char* digits_begin = p;
+
+		// values that do not fit are saturated rather than wrapped, the remaining digits still have to be consumed
+		std::uint64_t n = 0;
+
+#if defined(PARSE_INTEGER_SWAR)
+		while (last - p >= 8)
+		{
+			auto x = detail::load8(p);
+			int num_digits = detail::countLeadingDigits(x);
+
+			if (num_digits == 0)
+				break;
+
+			if (wide && n > saturated / powers_of_ten[num_digits])
+				n = saturated;
+			else
+				n = n * powers_of_ten[num_digits] + detail::decodeDigits(x, num_digits);
+			if (n > saturated)
+				n = saturated;
+
+			p += num_digits;
+
+			if (num_digits < 8)
+				break;
+		}
+
+		if (last - p < 8)
+#endif
+		{
+			for (; p != last && detail::isDecimalDigit(*p); ++p)
+			{
+				if (wide && n > saturated / 10)
+					n = saturated;
+				else
+					n = n * 10 + static_cast<unsigned>(*p - '0');
+				if (n > saturated)
+					n = saturated;
+			}
+		}
+
+		if (p == digits_begin)
+			return { first, std::errc::invalid_argument };
+
+		if (n > (negative ? magnitude : magnitude - 1))
+			return { p, std::errc::result_out_of_range };
+
+		// the negation is done on the unsigned value, which the smallest value of T needs
+		value = static_cast<T>(negative ? ~n + 1 : n);
+		return { p, std::errc() };
+	}
+
+	// parses a face vertex of the form v[/[t][/[n]]] exactly like the equivalent sequence of std::from_chars calls
+	// with '/' checks in between would: empty or malformed t and n slots are left at 0, only a missing v is invalid,
+	// and any index that does not fit into T makes the whole vertex out of range
+	template <typename T>
+	inline std::from_chars_result parseFaceVertex(const char* first, const char* last, T& v, T& n, T& t) noexcept
+	{
+		t = 0;
+		n = 0;
+
+		auto r = parseInteger(first, last, v);
+
+		if (r.ec != std::errc())
+			return r;
+
+		const char* p = r.ptr;
+
+		if (p != last && *p == '/')
+		{
+			if (r = parseInteger(++p, last, t); r.ec == std::errc::result_out_of_range)
+				return r;
+			p = r.ptr;
+
+			if (p != last && *p == '/')
+			{
+				if (r = parseInteger(++p, last, n); r.ec == std::errc::result_out_of_range)
+					return r;
+				p = r.ptr;
+			}
+		}
+
+		return { p, std::errc() };
+	}
+
+	// the slots that the vertices of a face statement carry: v, v/t, v//n or v/t/n
+	enum class FaceFormat
+	{
+		V,
+		VT,
+		VN,
+		VTN
+	};
+
+	// parses a face vertex only if it has exactly the slots of format F, giving the same result as parseFaceVertex;
+	// anything else, including indices that are out of range, is rejected as invalid_argument without consuming input
+	template <FaceFormat F, typename T>
+	inline std::from_chars_result parseFaceVertexAs(const char* first, const char* last, T& v, T& n, T& t) noexcept
+	{
+		constexpr bool has_t = F == FaceFormat::VT || F == FaceFormat::VTN;
+		constexpr bool has_n = F == FaceFormat::VN || F == FaceFormat::VTN;
+
+		t = 0;
+		n = 0;
+
+		auto r = parseInteger(first, last, v);
+
+		if (r.ec != std::errc())
+			return { first, std::errc::invalid_argument };
+
+		const char* p = r.ptr;
+
+		if constexpr (F != FaceFormat::V)
+		{
+			if (p == last || *p != '/')
+				return { first, std::errc::invalid_argument };
+
+			++p;
+
+			if constexpr (has_t)
+			{
+				if (r = parseInteger(p, last, t); r.ec != std::errc())
+					return { first, std::errc::invalid_argument };
+				p = r.ptr;
+			}
+
+			if constexpr (has_n)
+			{
+				if (p == last || *p != '/')
+					return { first, std::errc::invalid_argument };
+
+				if (r = parseInteger(++p, last, n); r.ec != std::errc())
+					return { first, std::errc::invalid_argument };
+				p = r.ptr;
+			}
+		}
+
+		if constexpr (!has_n)
+		{
+			if (p != last && *p == '/')
+				return { first, std::errc::invalid_argument };
+		}
+
+		return { p, std::errc() };
+	}
+
+	// determines the format of the face vertex at first, V if it is not a well-formed face vertex
+	inline FaceFormat detectFaceFormat(const char* first, const char* last) noexcept
+	{
+		int v, n, t;
+
+		if (parseFaceVertexAs<FaceFormat::VTN>(first, last, v, n, t).ec == std::errc())
+			return FaceFormat::VTN;
+		if (parseFaceVertexAs<FaceFormat::VN>(first, last, v, n, t).ec == std::errc())
+			return FaceFormat::VN;
+		if (parseFaceVertexAs<FaceFormat::VT>(first, last, v, n, t).ec == std::errc())
+			return FaceFormat::VT;
+		return FaceFormat::V;
+	}
+}
+
+#endif  // INCLUDED_PARSE_INTEGER
@@ -0,0 +1,255 @@
+#ifndef INCLUDED_PARSE_KERNELS
+#define INCLUDED_PARSE_KERNELS
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <optional>
+
+#include "scan.h"
+#include "structural_index.h"
+
+#if defined(PARSE_SCAN_AVX2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define PARSE_KERNEL(isa) __attribute__((target(isa), flatten))
+#else
+#define PARSE_KERNEL(isa)
+#endif
+
+
+namespace parse
+{
+	// the instruction sets that the bulk scanning kernels are built for
+	enum class InstructionSet
+	{
+		SCALAR,
+		SSE2,
+		AVX2,
+		AVX512
+	};
+
+	constexpr InstructionSet all_instruction_sets[] = { InstructionSet::SCALAR, InstructionSet::SSE2, InstructionSet::AVX2, InstructionSet::AVX512 };
+
+	constexpr std::string_view name(InstructionSet isa) noexcept
+	{
+		switch (isa)
+		{
+		case InstructionSet::SCALAR:
+			return "scalar";
+		case InstructionSet::SSE2:
+			return "sse2";
+		case InstructionSet::AVX2:
+			return "avx2";
+		case InstructionSet::AVX512:
+			return "avx512";
+		}
+		return "unknown";
+	}
+
+	constexpr std::optional<InstructionSet> parseInstructionSet(std::string_view name) noexcept
+	{
+		for (auto isa : all_instruction_sets)
+			if (parse::name(isa) == name)
+				return isa;
+		return {};
+	}
+
+	// whether this binary has kernels for isa and the CPU it is running on can execute them
+	inline bool supports(InstructionSet isa) noexcept
+	{
+		switch (isa)
+		{
+		case InstructionSet::SCALAR:
+			return true;
+
+#if defined(PARSE_SCAN_SSE2)
+		case InstructionSet::SSE2:
+			return true;
+#endif
+
+#if defined(PARSE_SCAN_AVX2) && defined(_MSC_VER)
+		case InstructionSet::AVX2:
+		case InstructionSet::AVX512:
+		{
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			// the OS has to save the vector registers on context switches
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool popcnt = (info[2] & (1 << 23)) != 0;
+			if (!osxsave || !popcnt)
+				return false;
+
+			auto xcr0 = _xgetbv(0);
+			__cpuidex(info, 7, 0);
+
+			if (isa == InstructionSet::AVX2)
+				return (info[1] & (1 << 5)) && (xcr0 & 0x06) == 0x06;
+			return (info[1] & (1 << 16)) && (info[1] & (1 << 30)) && (xcr0 & 0xE6) == 0xE6;
+		}
+#elif defined(PARSE_SCAN_AVX2)
+		case InstructionSet::AVX2:
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+
+		case InstructionSet::AVX512:
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("popcnt");
+#endif
+
+		default:
+			return false;
+		}
+	}
+
+	// the scans over large amounts of text, built once per instruction set and picked at runtime; the short scans
+	// between tokens stay inline and use the native instruction set, where a call would cost more than it saves
+	struct kernels
+	{
+		InstructionSet isa;
+		const char* (*findNewline)(const char* p, const char* end) noexcept;
+		std::size_t (*countNewlines)(const char* p, const char* end) noexcept;
+		void (*buildStructuralIndex)(StructuralIndex& index, const char* begin, const char* end) noexcept;
+	};
+
+	namespace detail
+	{
+		template <typename ISA>
+		struct kernel_set
+		{
+			static const char* findNewline(const char* p, const char* end) noexcept
+			{
+				return scanner<ISA>::template findFirstOf<'\n'>(p, end);
+			}
+
+			static std::size_t countNewlines(const char* p, const char* end) noexcept
+			{
+				return scanner<ISA>::template count<'\n'>(p, end);
+			}
+
+			static void buildStructuralIndex(StructuralIndex& index, const char* begin, const char* end) noexcept
+			{
+				structural_indexer<ISA>::build(index, begin, end);
+			}
+		};
+
+		// the AVX kernels are compiled for their instruction set no matter what the rest of the program is compiled for,
+		// everything they call is inlined into them so that it gets compiled for that instruction set as well
+
+#if defined(PARSE_SCAN_AVX2)
+		template <>
+		struct kernel_set<avx2>
+		{
+			PARSE_KERNEL("avx2,popcnt")
+			static const char* findNewline(const char* p, const char* end) noexcept
+			{
+				return scanner<avx2>::findFirstOf<'\n'>(p, end);
+			}
+
+			PARSE_KERNEL("avx2,popcnt")
+			static std::size_t countNewlines(const char* p, const char* end) noexcept
+			{
+				return scanner<avx2>::count<'\n'>(p, end);
+			}
+
+			PARSE_KERNEL("avx2,popcnt")
+			static void buildStructuralIndex(StructuralIndex& index, const char* begin, const char* end) noexcept
+			{
+				structural_indexer<avx2>::build(index, begin, end);
+			}
+		};
+#endif
+
+#if defined(PARSE_SCAN_AVX512)
+		template <>
+		struct kernel_set<avx512>
+		{
+			PARSE_KERNEL("avx512f,avx512bw,popcnt")
+			static const char* findNewline(const char* p, const char* end) noexcept
+			{
+				return scanner<avx512>::findFirstOf<'\n'>(p, end);
+			}
+
+			PARSE_KERNEL("avx512f,avx512bw,popcnt")
+			static std::size_t countNewlines(const char* p, const char* end) noexcept
+			{
+				return scanner<avx512>::count<'\n'>(p, end);
+			}
+
+			PARSE_KERNEL("avx512f,avx512bw,popcnt")
+			static void buildStructuralIndex(StructuralIndex& index, const char* begin, const char* end) noexcept
+			{
+				structural_indexer<avx512>::build(index, begin, end);
+			}
+		};
+#endif
+
+		template <typename ISA>
+		constexpr kernels makeKernels(InstructionSet isa) noexcept
+		{
+			return { isa, &kernel_set<ISA>::findNewline, &kernel_set<ISA>::countNewlines, &kernel_set<ISA>::buildStructuralIndex };
+		}
+
+		// isa has to be supported
+		inline kernels kernelsFor(InstructionSet isa) noexcept
+		{
+			switch (isa)
+			{
+#if defined(PARSE_SCAN_SSE2)
+			case InstructionSet::SSE2:
+				return makeKernels<sse2>(isa);
+#endif
+#if defined(PARSE_SCAN_AVX2)
+			case InstructionSet::AVX2:
+				return makeKernels<avx2>(isa);
+#endif
+#if defined(PARSE_SCAN_AVX512)
+			case InstructionSet::AVX512:
+				return makeKernels<avx512>(isa);
+#endif
+			default:
+				return makeKernels<scalar>(InstructionSet::SCALAR);
+			}
+		}
+
+		inline InstructionSet detectInstructionSet() noexcept
+		{
+			for (auto isa : { InstructionSet::AVX512, InstructionSet::AVX2, InstructionSet::SSE2 })
+				if (supports(isa))
+					return isa;
+			return InstructionSet::SCALAR;
+		}
+
+		inline kernels& selectedKernels() noexcept
+		{
+			static kernels k = kernelsFor(detectInstructionSet());
+			return k;
+		}
+	}
+
+	// the kernels for the best instruction set the CPU supports, unless overridden through useKernels
+	inline const kernels& activeKernels() noexcept
+	{
+		return detail::selectedKernels();
+	}
+
+	// switches to the kernels for isa if it is supported, which is meant for benchmarking and testing;
+	// must not be called while text is being parsed
+	inline bool useKernels(InstructionSet isa) noexcept
+	{
+		if (!supports(isa))
+			return false;
+
+		detail::selectedKernels() = detail::kernelsFor(isa);
+		return true;
+	}
+}
+
+#endif  // INCLUDED_PARSE_KERNELS
@@ -0,0 +1,70 @@
+#ifndef INCLUDED_PARSE_KEYWORD_TABLE
+#define INCLUDED_PARSE_KEYWORD_TABLE
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+
+namespace parse
+{
+	template <typename T>
+	struct keyword
+	{
+		std::string_view name;
+		T value;
+	};
+
+	// maps a fixed set of keywords to values through a perfect hash that is searched for at compile time,
+	// so that looking up a word costs one hash of its first and last character and a single comparison
+	template <typename T, std::size_t SIZE = 32>
+	class keyword_table
+	{
+		keyword<T> slots[SIZE] = {};
+		std::size_t multiplier = 0;
+
+		static constexpr std::size_t hash(std::string_view word, std::size_t multiplier) noexcept
+		{
+			return (static_cast<unsigned char>(word.front()) * multiplier + static_cast<unsigned char>(word.back()) + word.size()) % SIZE;
+		}
+
+	public:
+		template <std::size_t N>
+		constexpr keyword_table(const keyword<T> (&keywords)[N]) noexcept
+		{
+			for (std::size_t m = 1; m < 256 * SIZE; ++m)
+			{
+				bool collision = false;
+
+				for (std::size_t i = 0; i < N && !collision; ++i)
+					for (std::size_t j = 0; j < i && !collision; ++j)
+						collision = hash(keywords[i].name, m) == hash(keywords[j].name, m);
+
+				if (!collision)
+				{
+					for (std::size_t i = 0; i < N; ++i)
+						slots[hash(keywords[i].name, m)] = keywords[i];
+
+					multiplier = m;
+					return;
+				}
+			}
+		}
+
+		// false if no collision-free hash was found, the table needs to be larger then
+		constexpr bool perfect() const noexcept
+		{
+			return multiplier != 0;
+		}
+
+		// returns the value of word, or nullptr if word is not a keyword; word must not be empty
+		constexpr const T* find(std::string_view word) const noexcept
+		{
+			const auto& slot = slots[hash(word, multiplier)];
+			return slot.name == word ? &slot.value : nullptr;
+		}
+	};
+}
+
+#endif  // INCLUDED_PARSE_KEYWORD_TABLE
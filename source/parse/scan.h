@@ -0,0 +1,189 @@
+#ifndef INCLUDED_PARSE_SCAN
+#define INCLUDED_PARSE_SCAN
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define PARSE_SCAN_SSE2
+#endif
+
+// AVX2 and AVX-512 blocks are always available on top of SSE2, functions that use them have to be built for
+// their instruction set with PARSE_TARGET and may only run if the CPU supports it (see kernels.h)
+#if defined(PARSE_SCAN_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#define PARSE_SCAN_AVX2
+#define PARSE_SCAN_AVX512
+#endif
+
+#if defined(__GNUC__)
+#define PARSE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PARSE_TARGET(isa)
+#endif
+
+#include "bits.h"
+
+
+namespace parse
+{
+	// a block classifies ISA::width consecutive bytes at once, yielding one bit per byte that equals any of C...
+
+	struct scalar
+	{
+		static constexpr int width = 0;
+	};
+
+#if defined(PARSE_SCAN_SSE2)
+	struct sse2
+	{
+		static constexpr int width = 16;
+		static constexpr std::uint32_t all = 0xFFFFU;
+
+		template <char... C>
+		static std::uint32_t match(const char* p) noexcept
+		{
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			__m128i m = _mm_setzero_si128();
+			((m = _mm_or_si128(m, _mm_cmpeq_epi8(block, _mm_set1_epi8(C)))), ...);
+			return static_cast<std::uint32_t>(_mm_movemask_epi8(m));
+		}
+	};
+#endif
+
+#if defined(PARSE_SCAN_AVX2)
+	struct avx2
+	{
+		static constexpr int width = 32;
+		static constexpr std::uint32_t all = 0xFFFFFFFFU;
+
+		template <char... C>
+		PARSE_TARGET("avx2")
+		static std::uint32_t match(const char* p) noexcept
+		{
+			__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			__m256i m = _mm256_setzero_si256();
+			((m = _mm256_or_si256(m, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(C)))), ...);
+			return static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+		}
+	};
+#endif
+
+#if defined(PARSE_SCAN_AVX512)
+	struct avx512
+	{
+		static constexpr int width = 64;
+		static constexpr std::uint64_t all = ~std::uint64_t(0);
+
+		template <char... C>
+		PARSE_TARGET("avx512f,avx512bw")
+		static std::uint64_t match(const char* p) noexcept
+		{
+			__m512i block = _mm512_loadu_si512(p);
+			__mmask64 m = 0;
+			((m |= _mm512_cmpeq_epi8_mask(block, _mm512_set1_epi8(C))), ...);
+			return static_cast<std::uint64_t>(m);
+		}
+	};
+#endif
+
+	// the instruction set that the inline scans are compiled for, others are reached through kernels.h
+#if defined(__AVX2__)
+	using native = avx2;
+#elif defined(PARSE_SCAN_SSE2)
+	using native = sse2;
+#else
+	using native = scalar;
+#endif
+
+
+	template <char... C>
+	constexpr bool isAnyOf(char c) noexcept
+	{
+		return ((c == C) || ...);
+	}
+
+	template <typename ISA>
+	struct scanner
+	{
+		// classifies the 64 bytes starting at p, yielding one bit per byte that equals any of C...
+		template <char... C>
+		static std::uint64_t match64(const char* p) noexcept
+		{
+			std::uint64_t m = 0;
+
+			if constexpr (ISA::width != 0)
+			{
+				for (int i = 0; i < 64; i += ISA::width)
+					m |= static_cast<std::uint64_t>(ISA::template match<C...>(p + i)) << i;
+			}
+			else
+			{
+				for (int i = 0; i < 64; ++i)
+					m |= static_cast<std::uint64_t>(isAnyOf<C...>(p[i])) << i;
+			}
+
+			return m;
+		}
+
+		// returns a pointer to the first byte in [p, end) that equals any of C..., or end
+		template <char... C>
+		static const char* findFirstOf(const char* p, const char* end) noexcept
+		{
+			if constexpr (ISA::width != 0)
+			{
+				for (; end - p >= ISA::width; p += ISA::width)
+					if (auto m = ISA::template match<C...>(p))
+						return p + countTrailingZeros(m);
+			}
+
+			for (; p != end; ++p)
+				if (isAnyOf<C...>(*p))
+					return p;
+
+			return end;
+		}
+
+		// returns a pointer to the first byte in [p, end) that equals none of C..., or end
+		template <char... C>
+		static const char* findFirstNotOf(const char* p, const char* end) noexcept
+		{
+			if constexpr (ISA::width != 0)
+			{
+				for (; end - p >= ISA::width; p += ISA::width)
+					if (auto m = ~ISA::template match<C...>(p) & ISA::all)
+						return p + countTrailingZeros(m);
+			}
+
+			for (; p != end; ++p)
+				if (!isAnyOf<C...>(*p))
+					return p;
+
+			return end;
+		}
+
+		// returns the number of bytes in [p, end) that equal C
+		template <char C>
+		static std::size_t count(const char* p, const char* end) noexcept
+		{
+			std::size_t n = 0;
+
+			if constexpr (ISA::width != 0)
+			{
+				for (; end - p >= ISA::width; p += ISA::width)
+					n += popCount(ISA::template match<C>(p));
+			}
+
+			for (; p != end; ++p)
+				n += *p == C;
+
+			return n;
+		}
+	};
+
+	using scan = scanner<native>;
+}
+
+#endif  // INCLUDED_PARSE_SCAN
@@ -0,0 +1,88 @@
+#ifndef INCLUDED_PARSE_STRUCTURAL_INDEX
+#define INCLUDED_PARSE_STRUCTURAL_INDEX
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include "scan.h"
+
+
+namespace parse
+{
+	// offsets of all white space separated tokens and all newlines in a block of text
+	struct StructuralIndex
+	{
+		std::uint32_t* token_begin;
+		std::uint32_t* token_end;
+		std::uint32_t* newlines;
+		std::size_t num_tokens;
+		std::size_t num_newlines;
+	};
+
+	constexpr std::size_t maxTokens(std::size_t size) noexcept
+	{
+		return size / 2 + 1;
+	}
+
+	constexpr std::size_t maxNewlines(std::size_t size) noexcept
+	{
+		return size;
+	}
+
+	template <typename ISA>
+	struct structural_indexer
+	{
+		static void flatten(std::uint32_t* out, std::size_t& n, std::uint64_t mask, std::uint32_t offset) noexcept
+		{
+			for (; mask; mask &= mask - 1)
+				out[n++] = offset + static_cast<std::uint32_t>(countTrailingZeros(mask));
+		}
+
+		// fills index with the structure of [begin, end); the arrays in index must hold
+		// maxTokens(end - begin) and maxNewlines(end - begin) entries respectively
+		static void build(StructuralIndex& index, const char* begin, const char* end) noexcept
+		{
+			std::size_t num_tokens = 0;
+			std::size_t num_token_ends = 0;
+			std::size_t num_newlines = 0;
+
+			// the start of the text counts as a separator
+			std::uint64_t carry = 1;
+
+			auto size = static_cast<std::size_t>(end - begin);
+
+			for (std::size_t offset = 0; offset < size; offset += 64)
+			{
+				const char* block = begin + offset;
+
+				char tail[64];
+				if (size - offset < 64)
+				{
+					// pad the last block with separators so that a token running up to the end gets terminated
+					std::fill(std::copy(block, end, tail), tail + 64, ' ');
+					block = tail;
+				}
+
+				std::uint64_t nl = scanner<ISA>::template match64<'\n'>(block);
+				std::uint64_t sep = nl | scanner<ISA>::template match64<' ', '\t', '\r'>(block);
+				std::uint64_t preceded_by_sep = (sep << 1) | carry;
+				carry = sep >> 63;
+
+				flatten(index.token_begin, num_tokens, ~sep & preceded_by_sep, static_cast<std::uint32_t>(offset));
+				flatten(index.token_end, num_token_ends, sep & ~preceded_by_sep, static_cast<std::uint32_t>(offset));
+				flatten(index.newlines, num_newlines, nl, static_cast<std::uint32_t>(offset));
+			}
+
+			if (!carry)
+				index.token_end[num_token_ends++] = static_cast<std::uint32_t>(size);
+
+			index.num_tokens = num_tokens;
+			index.num_newlines = num_newlines;
+		}
+	};
+}
+
+#endif  // INCLUDED_PARSE_STRUCTURAL_INDEX